@@ -6,11 +6,259 @@
 #include <QHBoxLayout>
 #include <QTextCursor>
 #include <QTextBlock>
+#include <QTextLayout>
+#include <QTextDocument>
 #include <QLineEdit>
+#include <QScrollBar>
+#include <QDropEvent>
+#include <QMultiHash>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 using namespace CEnhancedList;
 
 
+void HeightIndex::build(const QVector<int>& heights)
+{
+    this->m_heights = heights;
+    int n = heights.count();
+    this->m_tree.fill(0, n + 1);
+    for (int i = 1; i <= n; i++) {
+        this->m_tree[i] += heights.at(i - 1);
+        int parent = i + (i & -i);
+        if (parent <= n) this->m_tree[parent] += this->m_tree.at(i);
+    }
+}
+
+void HeightIndex::setHeight(int row, int height)
+{
+    int delta = height - this->m_heights.at(row);
+    if (delta == 0) return;
+    this->m_heights[row] = height;
+    for (int i = row + 1; i < this->m_tree.count(); i += (i & -i)) {
+        this->m_tree[i] += delta;
+    }
+}
+
+int HeightIndex::offset(int row) const
+{
+    int sum = 0;
+    for (int i = row; i > 0; i -= (i & -i)) {
+        sum += this->m_tree.at(i);
+    }
+    return sum;
+}
+
+int HeightIndex::rowAt(int y) const
+{
+    if (y < 0) return -1;
+    int n = this->count();
+    int step = 1;
+    while (step * 2 <= n) step *= 2;
+    int pos = 0;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && this->m_tree.at(pos + step) <= y) {
+            pos += step;
+            y -= this->m_tree.at(pos);
+        }
+    }
+    return pos < n ? pos : -1;
+}
+
+
+
+
+
+
+EditHistory::EditHistory()
+{
+    this->m_cursor = 0;
+    this->m_grouping = false;
+    this->m_groupStarted = false;
+    this->m_maximumDepth = 100;
+    this->m_maximumSize = 4 * 1024 * 1024;
+}
+
+void EditHistory::recordEdit(int row, const QString& before, const QString& after)
+{
+    int prefix = 0;
+    int common = qMin(before.size(), after.size());
+    while (prefix < common && before.at(prefix) == after.at(prefix)) prefix++;
+    int suffix = 0;
+    while (suffix < common - prefix && before.at(before.size() - 1 - suffix) == after.at(after.size() - 1 - suffix)) suffix++;
+
+    Entry entry { Action::Edit, row, row, prefix, 0, 0, 0, 1, false };
+    this->append(entry, QStringView(before).mid(prefix, before.size() - prefix - suffix), QStringView(after).mid(prefix, after.size() - prefix - suffix));
+}
+
+void EditHistory::recordInsert(int row, const QString& text)
+{
+    this->append(Entry { Action::Insert, row, row, 0, 0, 0, 0, 1, false }, QStringView(), text);
+}
+
+void EditHistory::recordTake(int row, const QString& text)
+{
+    this->append(Entry { Action::Take, row, row, 0, 0, 0, 0, 1, false }, text, QStringView());
+}
+
+void EditHistory::recordMove(int from, int count, int to)
+{
+    this->append(Entry { Action::Move, from, to, 0, 0, 0, 0, count, false }, QStringView(), QStringView());
+}
+
+void EditHistory::clear()
+{
+    this->m_entries.clear();
+    this->m_arena.clear();
+    this->m_cursor = 0;
+}
+
+QString EditHistory::undone(const Entry& entry, const QString& current, QStringView removed)
+{
+    QString text = current.left(entry.prefix);
+    text.append(removed.data(), static_cast<int>(removed.size()));
+    text.append(current.midRef(entry.prefix + entry.insertedLength));
+    return text;
+}
+
+QString EditHistory::redone(const Entry& entry, const QString& current, QStringView inserted)
+{
+    QString text = current.left(entry.prefix);
+    text.append(inserted.data(), static_cast<int>(inserted.size()));
+    text.append(current.midRef(entry.prefix + entry.removedLength));
+    return text;
+}
+
+void EditHistory::append(const Entry& entry, QStringView removed, QStringView inserted)
+{
+    if (this->m_maximumDepth <= 0) return;
+
+    // Recording after an undo drops the redo branch
+    if (this->m_cursor < this->m_entries.count()) {
+        this->m_arena.truncate(this->m_entries.at(this->m_cursor).offset);
+        this->m_entries.resize(this->m_cursor);
+    }
+
+    Entry stored = entry;
+    stored.offset = this->m_arena.size();
+    stored.removedLength = static_cast<int>(removed.size());
+    stored.insertedLength = static_cast<int>(inserted.size());
+    stored.linked = this->m_grouping && this->m_groupStarted;
+    this->m_groupStarted = this->m_grouping;
+    this->m_arena.append(removed.data(), stored.removedLength);
+    this->m_arena.append(inserted.data(), stored.insertedLength);
+    this->m_entries.append(stored);
+    this->m_cursor = this->m_entries.count();
+    this->trim();
+}
+
+void EditHistory::trim()
+{
+    int drop = 0;
+    qint64 size = this->size();
+    while (drop < this->m_entries.count()
+           && (this->m_entries.count() - drop > this->m_maximumDepth || size > this->m_maximumSize)) {
+        // Groups are dropped whole so undo never replays half of one
+        do {
+            const Entry& entry = this->m_entries.at(drop);
+            size -= (entry.removedLength + entry.insertedLength) * qint64(sizeof(QChar)) + qint64(sizeof(Entry));
+            drop++;
+        } while (drop < this->m_entries.count() && this->m_entries.at(drop).linked);
+    }
+    if (drop == 0) return;
+
+    this->m_entries.remove(0, drop);
+    this->m_cursor = qMax(0, this->m_cursor - drop);
+    if (this->m_entries.isEmpty()) {
+        this->m_arena.clear();
+        return;
+    }
+
+    // Compact once the dead head of the arena outweighs the live part
+    int dead = this->m_entries.first().offset;
+    if (dead > this->m_arena.size() / 2) {
+        this->m_arena.remove(0, dead);
+        this->m_arena.squeeze();
+        for (Entry& entry: this->m_entries) {
+            entry.offset -= dead;
+        }
+    }
+}
+
+
+
+
+
+
+quint64 FuzzyMatcher::mask(QStringView text)
+{
+    quint64 mask = 0;
+    for (QChar c: text) {
+        ushort u = c.toLower().unicode();
+        if (u >= 'a' && u <= 'z') mask |= quint64(1) << (u - 'a');
+        else if (u >= '0' && u <= '9') mask |= quint64(1) << (26 + u - '0');
+        else if (u < 128) mask |= quint64(1) << (36 + u % 27);
+        else mask |= quint64(1) << 63;
+    }
+    return mask;
+}
+
+static bool isWordStart(QStringView text, int i)
+{
+    if (i == 0) return true;
+    QChar previous = text.at(i - 1);
+    return !previous.isLetterOrNumber() || (previous.isLower() && text.at(i).isUpper());
+}
+
+int FuzzyMatcher::score(QStringView text, QStringView pattern)
+{
+    int n = static_cast<int>(text.size());
+    int m = static_cast<int>(pattern.size());
+    if (m == 0) return 0;
+
+    // Forward pass finds where the first full match ends...
+    int p = 0;
+    int end = -1;
+    for (int i = 0; i < n; i++) {
+        if (text.at(i).toLower() == pattern.at(p) && ++p == m) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) return -1;
+
+    // ...backward pass from there gives the tightest window
+    int start = end;
+    p = m - 1;
+    for (int i = end; i >= 0; i--) {
+        if (text.at(i).toLower() == pattern.at(p) && --p < 0) {
+            start = i;
+            break;
+        }
+    }
+
+    int score = 0;
+    int previous = -2;
+    p = 0;
+    for (int i = start; i <= end && p < m; i++) {
+        if (text.at(i).toLower() != pattern.at(p)) continue;
+        score += 16;
+        if (previous == i - 1) score += 8;
+        if (isWordStart(text, i)) score += 10;
+        previous = i;
+        p++;
+    }
+    return score - (end - start + 1 - m);
+}
+
+
+
+
+
+
+int ItemEventFilter::s_instances = 0;
+
 bool ItemEventFilter::eventFilter(QObject* obj, QEvent* event)
 {
     if (event->type() == QEvent::KeyRelease)
@@ -44,31 +292,68 @@ bool ItemEventFilter::eventFilter(QObject* obj, QEvent* event)
 
 
 Item::Item(QListWidget* parent)
+    : Item(parent, ItemOptions())
+{
+    parent->setItemWidget(this, this->newLabel());
+}
+
+Item::Item(QListWidget* parent, const ItemOptions& options)
     : QObject()
     , QListWidgetItem(parent)
 {
     this->m_parent = parent;
-    this->m_text = "";
-    this->m_margin = 5;
-    this->m_wordwrap = true;
-    this->m_format = Qt::PlainText;
+    this->m_row = -1;
+    this->m_charMask = 0;
+    this->m_charMaskValid = false;
+    this->m_section = -1;
+    this->m_isHeader = false;
+    this->m_hidden = false;
+    this->m_filtered = false;
+    this->m_sortRank = 0;
+    this->m_widgetBytes = 0;
+    this->m_text = options.text;
+    this->m_margin = options.margin;
+    this->m_wordwrap = options.wordWrap;
+    this->m_format = options.format;
     this->m_editText = "";
     this->m_isEditing = false;
-    this->m_colorEditBackground = "#FFFFFF";
-    this->m_colorEditForeground = "#000000";
-    this->m_colorEditBorder = "#000000";
-    this->m_colorReadForegroundDefault = "#000000";
-    this->m_colorReadForegroundSelected = "#000000";
+    this->m_colorEditBackground = options.colorEditBackground;
+    this->m_colorEditForeground = options.colorEditForeground;
+    this->m_colorEditBorder = options.colorEditBorder;
+    this->m_colorReadForegroundDefault = options.colorReadForegroundDefault;
+    this->m_colorReadForegroundSelected = options.colorReadForegroundSelected;
+
+    this->m_transformFn = options.transformFn;
+    this->m_highlighterFn = options.highlighterFn;
+    this->m_highlighted = false;
+    this->m_highlighter = nullptr;
+    this->m_editTimer = nullptr;
+
+    if (options.editable) this->setFlags(this->flags() | Qt::ItemIsEditable);
+}
 
-    this->m_transformFn = [](Item* item){ return item->text(); };
+Item::~Item()
+{
+    if (!this->m_key.isNull()) emit this->onKeyReleased(this->m_key);
+    if (this->m_isHeader) emit this->onHeaderReleased(this->m_section);
+    qint64 highlighted = this->m_highlightedHtml.size() * qint64(sizeof(QChar));
+    if (this->m_widgetBytes != 0 || highlighted != 0) emit this->onCacheChanged(-this->m_widgetBytes, -highlighted);
+}
 
-    QLabel* label = new QLabel();
-    parent->setItemWidget(this, label);
+quint64 Item::charMask() const
+{
+    if (!this->m_charMaskValid) {
+        this->m_charMask = FuzzyMatcher::mask(this->m_text);
+        this->m_charMaskValid = true;
+    }
+    return this->m_charMask;
 }
 
 bool Item::operator <(const QListWidgetItem& other) const
 {
-    return this->text().compare(static_cast<const Item&>(other).text(), Qt::CaseInsensitive) < 0;
+    const Item& item = static_cast<const Item&>(other);
+    if (this->m_sortRank != item.m_sortRank) return this->m_sortRank < item.m_sortRank;
+    return this->text().compare(item.text(), Qt::CaseInsensitive) < 0;
 }
 
 void Item::startEdit()
@@ -88,6 +373,11 @@ void Item::startEdit()
         auto tc = editText->textCursor();
         tc.movePosition(QTextCursor::End);
         editText->setTextCursor(tc);
+        if (this->m_highlighterFn) this->m_highlighter = this->m_highlighterFn(editText->document());
+        this->m_editTimer = new QTimer(editText);
+        this->m_editTimer->setSingleShot(true);
+        this->m_editTimer->setInterval(50);
+        connect(this->m_editTimer, &QTimer::timeout, this, &Item::onEditSettled);
         connect(editText, &QPlainTextEdit::textChanged, this, &Item::onEditChanged);
     } else {
         edit = new QLineEdit();
@@ -98,7 +388,7 @@ void Item::startEdit()
         connect(editLine, &QLineEdit::textChanged, this, &Item::onEditLineChanged);
     }
 
-    auto eventFilter = new CEnhancedList::ItemEventFilter();
+    auto eventFilter = new CEnhancedList::ItemEventFilter(edit);
     connect(eventFilter, &CEnhancedList::ItemEventFilter::stopEdit, this, &CEnhancedList::Item::onEditStopped);
     connect(eventFilter, &CEnhancedList::ItemEventFilter::saveEdit, this, &CEnhancedList::Item::onEditSaved);
     connect(eventFilter, &CEnhancedList::ItemEventFilter::saveLineEdit, this, &CEnhancedList::Item::onEditLineSaved);
@@ -106,8 +396,10 @@ void Item::startEdit()
 
     QWidget* widget = this->m_parent->itemWidget(this);
     this->m_parent->setItemWidget(this, edit);
-    widget->close();
-    widget->deleteLater();
+    if (widget != nullptr) {
+        widget->close();
+        widget->deleteLater();
+    }
 
     emit this->onChanged();
     edit->setFocus();
@@ -115,17 +407,20 @@ void Item::startEdit()
 
 void Item::onEditChanged()
 {
-    QWidget* widget = this->m_parent->itemWidget(this);
-    QPlainTextEdit* edit = static_cast<QPlainTextEdit*>(widget);
+    // Coalesce fast typing: the text copy and row re-measure run once typing pauses
+    if (this->m_editTimer != nullptr) this->m_editTimer->start();
+}
+
+void Item::onEditSettled()
+{
+    QPlainTextEdit* edit = qobject_cast<QPlainTextEdit*>(this->m_parent->itemWidget(this));
     if (edit != nullptr) {
         this->m_editText = edit->toPlainText();
 
         emit this->onChanged();
 
-        QTextCursor c = edit->textCursor();
-        QTextCursor cursor(edit->document()->findBlockByLineNumber(0));
-        edit->setTextCursor(cursor);
-        edit->setTextCursor(c);
+        edit->verticalScrollBar()->setValue(0);
+        edit->ensureCursorVisible();
     }
 }
 
@@ -140,13 +435,15 @@ void Item::onEditLineChanged()
 
 void Item::onEditStopped()
 {
+    // Closing the editor after a save also reports a focus out
+    if (!this->m_isEditing) return;
     this->m_isEditing = false;
+    this->m_editText.clear();
+    if (this->m_editTimer != nullptr) this->m_editTimer->stop();
+    this->m_editTimer = nullptr;
+    this->m_highlighter = nullptr;
 
-    QLabel* label = new QLabel();
-    label->setText(this->m_transformFn(this));
-    label->setMargin(this->m_margin);
-    label->setWordWrap(this->m_wordwrap);
-    label->setTextFormat(this->m_format);
+    QLabel* label = this->newLabel();
 
     QWidget* widget = this->m_parent->itemWidget(this);
     this->m_parent->setItemWidget(this, label);
@@ -159,14 +456,23 @@ void Item::onEditStopped()
 
 void Item::onEditSaved()
 {
+    QPlainTextEdit* edit = qobject_cast<QPlainTextEdit*>(this->m_parent->itemWidget(this));
+    if (edit != nullptr) this->m_editText = edit->toPlainText();
+    if (this->m_editTimer != nullptr) this->m_editTimer->stop();
+    this->m_editTimer = nullptr;
+
+    // Keep the editor's highlighting for the read-only row instead of highlighting again
+    this->m_highlighted = edit != nullptr && this->m_highlighter != nullptr && this->m_format == Qt::PlainText && !this->m_transformFn;
+    this->setHighlightedHtml(this->m_highlighted ? Item::highlightedHtml(edit->document()) : QString());
+    this->m_highlighter = nullptr;
+
     this->m_isEditing = false;
-    this->m_text = this->m_editText;
+    QString previous = std::move(this->m_text);
+    this->m_text = std::move(this->m_editText);
+    this->m_editText.clear();
+    this->m_charMaskValid = false;
 
-    QLabel* label = new QLabel();
-    label->setText(this->m_transformFn(this));
-    label->setMargin(this->m_margin);
-    label->setWordWrap(this->m_wordwrap);
-    label->setTextFormat(this->m_format);
+    QLabel* label = this->newLabel();
 
     QWidget* widget = this->m_parent->itemWidget(this);
     this->m_parent->setItemWidget(this, label);
@@ -176,9 +482,109 @@ void Item::onEditSaved()
     emit this->onChanged();
     this->m_parent->setFocus();
 
+    if (previous != this->m_text) emit this->onReplaced(previous);
     emit this->onEdited();
 }
 
+QLabel* Item::newLabel()
+{
+    // Everything is set before the text, so the text is laid out once
+    QLabel* label = new QLabel();
+    label->setMargin(this->m_margin);
+    label->setWordWrap(this->m_wordwrap);
+    label->setStyleSheet(this->labelStyle());
+    this->applyLabelText(label);
+    return label;
+}
+
+QString Item::labelStyle() const
+{
+    if (this->m_isHeader) return "QLabel { font-weight: bold; color: " + this->m_colorReadForegroundDefault + "}";
+    if (this->isSelected()) return "QLabel { color: " + this->m_colorReadForegroundSelected + "}";
+    return "QLabel { color: " + this->m_colorReadForegroundDefault + "}";
+}
+
+QString Item::transformedText()
+{
+    return this->m_transformFn ? this->m_transformFn(this) : this->m_text;
+}
+
+void Item::applyLabelText(QLabel* label)
+{
+    // Highlighting shows the raw text, so it only applies to untransformed plain text rows
+    if (!this->m_highlighted || this->m_transformFn || !this->m_highlighterFn || this->m_format != Qt::PlainText) {
+        label->setTextFormat(this->m_format);
+        label->setText(this->transformedText());
+        return;
+    }
+    if (this->m_highlightedHtml.isEmpty()) this->rehighlight();
+    label->setTextFormat(Qt::RichText);
+    label->setText(this->m_highlightedHtml);
+}
+
+void Item::rehighlight()
+{
+    QTextDocument document;
+    document.setPlainText(this->m_text);
+    QSyntaxHighlighter* highlighter = this->m_highlighterFn(&document);
+    if (highlighter == nullptr) return;
+    highlighter->rehighlight();
+    this->setHighlightedHtml(Item::highlightedHtml(&document));
+    delete highlighter;
+}
+
+void Item::setHighlightedHtml(const QString& html)
+{
+    qint64 delta = (html.size() - this->m_highlightedHtml.size()) * qint64(sizeof(QChar));
+    this->m_highlightedHtml = html;
+    if (delta != 0) emit this->onCacheChanged(0, delta);
+}
+
+QString Item::highlightedHtml(QTextDocument* document)
+{
+    QString html = "<div style=\"white-space: pre-wrap;\">";
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (block != document->begin()) html += "<br/>";
+        const QString text = block.text();
+        QVector<QTextLayout::FormatRange> ranges = block.layout()->formats();
+        std::sort(ranges.begin(), ranges.end(), [](const QTextLayout::FormatRange& a, const QTextLayout::FormatRange& b){ return a.start < b.start; });
+
+        int pos = 0;
+        for (const QTextLayout::FormatRange& range: ranges) {
+            if (range.start < pos || range.length <= 0) continue;
+            QString style;
+            if (range.format.foreground().style() != Qt::NoBrush) style += "color: " + range.format.foreground().color().name() + ";";
+            if (range.format.fontWeight() > QFont::Normal) style += "font-weight: bold;";
+            if (range.format.fontItalic()) style += "font-style: italic;";
+            if (range.format.fontUnderline()) style += "text-decoration: underline;";
+            html += text.mid(pos, range.start - pos).toHtmlEscaped();
+            html += "<span style=\"" + style + "\">" + text.mid(range.start, range.length).toHtmlEscaped() + "</span>";
+            pos = range.start + range.length;
+        }
+        html += text.mid(pos).toHtmlEscaped();
+    }
+    return html + "</div>";
+}
+
+qint64 Item::ensureLabel()
+{
+    if (this->m_isEditing || this->m_parent->itemWidget(this) != nullptr) return 0;
+    this->m_parent->setItemWidget(this, this->newLabel());
+
+    // Estimated: a QLabel with its private data plus the shown text
+    this->m_widgetBytes = 1024 + this->m_text.size() * qint64(sizeof(QChar));
+    return this->m_widgetBytes;
+}
+
+qint64 Item::releaseLabel()
+{
+    if (this->m_isEditing) return 0;
+    this->m_parent->removeItemWidget(this);
+    qint64 bytes = this->m_widgetBytes;
+    this->m_widgetBytes = 0;
+    return bytes;
+}
+
 void Item::onEditLineSaved()
 {
     if (!this->m_wordwrap) this->onEditSaved();
@@ -186,9 +592,16 @@ void Item::onEditLineSaved()
 
 int Item::heightForWidth(int width)
 {
-    QLabel label(this->m_isEditing ? this->m_editText : this->m_transformFn(this));
+    if (this->m_isHeader) return this->m_parent->fontMetrics().height() + 2 * this->m_margin;
+
+    QLabel label;
+    if (this->m_isEditing) {
+        label.setTextFormat(Qt::PlainText);
+        label.setText(this->m_editText);
+    } else {
+        this->applyLabelText(&label);
+    }
     label.setMargin(this->m_margin);
-    label.setTextFormat(this->m_isEditing ? Qt::PlainText : this->m_format);
     label.setWordWrap(this->m_wordwrap);
     return label.heightForWidth(width);
 }
@@ -196,9 +609,33 @@ int Item::heightForWidth(int width)
 void Item::setText(const QString& text)
 {
     this->m_text = text;
+    this->redrawText();
+}
+
+void Item::setText(QString&& text)
+{
+    this->m_text = std::move(text);
+    this->redrawText();
+}
+
+void Item::setText(QStringView text, TextOwnership ownership)
+{
+    if (ownership == TextOwnership::External) {
+        this->m_text = QString::fromRawData(text.data(), static_cast<int>(text.size()));
+    } else {
+        this->m_text = text.toString();
+    }
+    this->redrawText();
+}
+
+void Item::redrawText()
+{
+    this->m_charMaskValid = false;
+    this->setHighlightedHtml(QString());
+    if (this->m_isEditing) return;
     QWidget* widget = this->m_parent->itemWidget(this);
     QLabel* label = static_cast<QLabel*>(widget);
-    if (label != nullptr) label->setText(this->m_transformFn(this));
+    if (label != nullptr) this->applyLabelText(label);
 }
 
 void Item::setMargin(int margin)
@@ -220,9 +657,11 @@ void Item::setWordWrap(bool on)
 void Item::setTextFormat(Qt::TextFormat format)
 {
     this->m_format = format;
+    if (format != Qt::PlainText) this->setHighlightedHtml(QString());
+    if (this->m_isEditing) return;
     QWidget* widget = this->m_parent->itemWidget(this);
     QLabel* label = static_cast<QLabel*>(widget);
-    if (label != nullptr) label->setTextFormat(format);
+    if (label != nullptr) this->applyLabelText(label);
 }
 
 void Item::redraw()
@@ -232,12 +671,8 @@ void Item::redraw()
     QLabel* label = static_cast<QLabel*>(widget);
     if (label != nullptr)
     {
-        label->setText(this->m_transformFn(this));
-        if (this->isSelected()) {
-            label->setStyleSheet("QLabel { color: " + this->m_colorReadForegroundSelected + "}");
-        } else {
-            label->setStyleSheet("QLabel { color: " + this->m_colorReadForegroundDefault + "}");
-        }
+        this->applyLabelText(label);
+        label->setStyleSheet(this->labelStyle());
     }
 }
 
@@ -261,12 +696,21 @@ Widget::Widget(QWidget* parent) : QWidget(parent)
     this->m_list = new QListWidget();
     this->m_list->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     this->m_list->setEditTriggers(QAbstractItemView::EditKeyPressed | QAbstractItemView::DoubleClicked);
+    this->m_heightsDirty = true;
+    this->m_replaying = false;
+    this->m_rowsDirtyFrom = 0;
+    this->m_memoryBudget = 0;
+    this->m_cachesReleased = false;
+    this->m_labelsPending = false;
+    this->m_widgetBytes = 0;
+    this->m_highlightedBytes = 0;
+    this->m_sortOrder = Qt::AscendingOrder;
+    CacheManager::instance()->registerWidget(this);
 
     this->setEditable(false);
     this->setMargin(5);
     this->setFormat(Qt::PlainText);
     this->setWordWrap(true);
-    this->setTransformFn([](Item* item){ return item->text(); });
     this->m_colorEditBackground = "#FFFFFF";
     this->m_colorEditForeground = "#000000";
     this->m_colorEditBorder = "#000000";
@@ -288,69 +732,199 @@ Widget::Widget(QWidget* parent) : QWidget(parent)
     connect(this->m_list, &QListWidget::itemEntered, this, &Widget::onItemEntered);
     connect(this->m_list, &QListWidget::itemPressed, this, &Widget::onItemPressed);
     connect(this->m_list, &QListWidget::itemSelectionChanged, this, &Widget::itemSelectionChanged);
+    this->m_list->viewport()->installEventFilter(this);
+    connect(this->m_list->verticalScrollBar(), &QScrollBar::valueChanged, this, &Widget::ensureVisibleLabels);
+
+    QAbstractItemModel* model = this->m_list->model();
+    connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int){ this->invalidateRows(first); });
+    connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex&, int first, int){ this->invalidateRows(first); });
+    connect(model, &QAbstractItemModel::rowsMoved, this, [this](const QModelIndex&, int first, int, const QModelIndex&, int row){ this->invalidateRows(qMin(first, row)); });
+    connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &Widget::onRowsAboutToBeRemoved);
+    connect(model, &QAbstractItemModel::layoutChanged, this, &Widget::onRowsChanged);
+    connect(model, &QAbstractItemModel::modelReset, this, &Widget::onRowsChanged);
 }
 
 Widget::~Widget()
 {
-    this->m_list->deleteLater();
+    CacheManager::instance()->unregisterWidget(this);
+
+    // Items report key and cache releases while they die, so delete them while the members are
+    // still alive; the view and model no longer reach this widget while they are torn down
+    this->m_list->disconnect(this);
+    this->m_list->model()->disconnect(this);
+    this->m_list->verticalScrollBar()->disconnect(this);
+    this->m_list->viewport()->removeEventFilter(this);
+    this->m_sections.clear();
+    delete this->m_list;
+    this->m_list = nullptr;
 }
 
-CEnhancedList::Item* Widget::addItem(const QString& label)
+CEnhancedList::Item* Widget::newItem(const QString& text)
 {
-    Item* item = new Item(this->m_list);
-    if (this->m_editable) item->setFlags(item->flags() | Qt::ItemIsEditable);
-    item->setTransformFn(this->m_transformFn);
-    item->setColors(this->m_colorEditBackground, this->m_colorEditForeground, this->m_colorEditBorder, this->m_colorReadForegroundDefault, this->m_colorReadForegroundSelected);
-    item->setText(label);
-    item->setMargin(this->m_margin);
-    item->setTextFormat(this->m_format);
-    item->setWordWrap(this->wordWrap());
+    ItemOptions options;
+    options.text = text;
+    options.margin = this->m_margin;
+    options.wordWrap = this->wordWrap();
+    options.format = this->m_format;
+    options.editable = this->m_editable;
+    options.transformFn = this->m_transformFn;
+    options.highlighterFn = this->m_highlighterFn;
+    options.colorEditBackground = this->m_colorEditBackground;
+    options.colorEditForeground = this->m_colorEditForeground;
+    options.colorEditBorder = this->m_colorEditBorder;
+    options.colorReadForegroundDefault = this->m_colorReadForegroundDefault;
+    options.colorReadForegroundSelected = this->m_colorReadForegroundSelected;
+
+    Item* item = this->createItem(options);
+    this->scheduleLabels();
     connect(item, &Item::onChanged, this, &Widget::onEditChanged);
     connect(item, &Item::onEdited, this, &Widget::onItemEdited);
+    connect(item, &Item::onReplaced, this, &Widget::onItemReplaced);
+    connect(item, &Item::onCacheChanged, this, &Widget::onItemCacheChanged);
+    return item;
+}
+
+CEnhancedList::Item* Widget::addItem(const QString& label)
+{
+    Item* item = this->newItem(label);
     return this->addItem(item);
 }
 
 CEnhancedList::Item* Widget::addItem(CEnhancedList::Item* item)
 {
     this->m_list->addItem(item);
+    this->adoptSection(this->row(item), 1);
+    if (!this->m_replaying) this->m_history.recordInsert(this->m_list->count() - 1, item->text());
     return item;
 }
 
+CEnhancedList::Item* Widget::addItem(QStringView label, TextOwnership ownership)
+{
+    Item* item = this->newItem();
+    item->setText(label, ownership);
+    return this->addItem(item);
+}
+
+bool Widget::beginBulkInsert(int count, qint64 length)
+{
+    // A bulk insert is one undo step; one too large for the history limits clears it instead
+    bool replaying = this->m_replaying;
+    if (replaying) return replaying;
+    if (this->m_history.fits(count, length)) {
+        this->m_history.beginGroup();
+    } else {
+        this->m_history.clear();
+        this->m_replaying = true;
+    }
+    return replaying;
+}
+
+void Widget::endBulkInsert(bool replaying)
+{
+    if (!replaying) this->m_history.endGroup();
+    this->m_replaying = replaying;
+}
+
 QList<CEnhancedList::Item*> Widget::addItems(const QStringList& labels)
 {
+    qint64 length = 0;
+    for (const QString& label: labels) length += label.size();
+    bool replaying = this->beginBulkInsert(labels.count(), length);
+
     QList<Item*> items;
+    items.reserve(labels.count());
     for (const QString& label: labels) {
         items.append(this->addItem(label));
     }
+    this->endBulkInsert(replaying);
+    return items;
+}
+
+QList<CEnhancedList::Item*> Widget::addItems(const QVector<QStringView>& labels, TextOwnership ownership)
+{
+    qint64 length = 0;
+    for (QStringView label: labels) length += label.size();
+    bool replaying = this->beginBulkInsert(labels.count(), length);
+
+    QList<Item*> items;
+    items.reserve(labels.count());
+    for (QStringView label: labels) {
+        items.append(this->addItem(label, ownership));
+    }
+    this->endBulkInsert(replaying);
+    return items;
+}
+
+QList<CEnhancedList::Item*> Widget::addItems(QStringView buffer, QChar separator, TextOwnership ownership)
+{
+    int parts = static_cast<int>(std::count(buffer.begin(), buffer.end(), separator)) + 1;
+    bool replaying = this->beginBulkInsert(parts, buffer.size());
+
+    // Empty parts between separators are kept; a trailing separator ends the last row
+    QList<Item*> items;
+    qsizetype start = 0;
+    while (start < buffer.size()) {
+        qsizetype end = buffer.indexOf(separator, start);
+        if (end < 0) end = buffer.size();
+        items.append(this->addItem(buffer.mid(start, end - start), ownership));
+        start = end + 1;
+    }
+    this->endBulkInsert(replaying);
     return items;
 }
 
 CEnhancedList::Item* Widget::insertItem(int row, CEnhancedList::Item* item)
 {
-    this->m_list->insertItem(row, item);
+    if (item->listWidget() == this->m_list) {
+        int from = this->row(item);
+        int to = qBound(0, row, this->m_list->count() - 1);
+        if (this->moveRow(from, to)) {
+            item->m_row = to;
+            if (!this->m_replaying) this->m_history.recordMove(from, 1, to);
+        }
+    } else {
+        this->m_list->insertItem(row, item);
+        this->adoptSection(this->row(item), 1);
+        if (!this->m_replaying) this->m_history.recordInsert(this->row(item), item->text());
+    }
     return item;
 }
 
 CEnhancedList::Item* Widget::insertItem(int row, const QString& label)
 {
-    Item* item = new Item(this->m_list);
-    if (this->m_editable) item->setFlags(item->flags() | Qt::ItemIsEditable);
-    item->setTransformFn(this->m_transformFn);
-    item->setColors(this->m_colorEditBackground, this->m_colorEditForeground, this->m_colorEditBorder, this->m_colorReadForegroundDefault, this->m_colorReadForegroundSelected);
-    item->setText(label);
-    item->setMargin(this->m_margin);
-    item->setTextFormat(this->m_format);
-    item->setWordWrap(this->wordWrap());
-    return this->insertItem(row, item);
+    Item* item = this->newItem(label);
+    this->placeNewItem(row, item);
+    return item;
+}
+
+void Widget::placeNewItem(int row, CEnhancedList::Item* item)
+{
+    // New items start as the last row; a sorted list places them itself
+    int last = this->m_list->count() - 1;
+    if (this->m_list->isSortingEnabled()) {
+        row = this->row(item);
+    } else {
+        row = qBound(0, row, last);
+        this->moveRow(last, row);
+        item->m_row = row;
+    }
+    this->adoptSection(row, 1);
+    if (!this->m_replaying) this->m_history.recordInsert(row, item->text());
 }
 
 QList<CEnhancedList::Item*> Widget::insertItems(int row, const QStringList& labels)
 {
+    qint64 length = 0;
+    for (const QString& label: labels) length += label.size();
+    bool replaying = this->beginBulkInsert(labels.count(), length);
+
     QList<Item*> items;
+    items.reserve(labels.count());
     for (int i = 0; i < labels.count(); i++) {
         const QString& label = labels.at(i);
         items.append(this->insertItem(row + i, label));
     }
+    this->endBulkInsert(replaying);
     return items;
 }
 
@@ -372,9 +946,9 @@ QList<CEnhancedList::Item*> Widget::items(const QMimeData* data) const
 QList<CEnhancedList::Item*> Widget::findItems(std::function<bool(CEnhancedList::Item*)> fn) const
 {
     QList<Item*> items;
-    for (auto item: this->m_list->findItems("", Qt::MatchContains)) {
-        auto eItem = static_cast<Item*>(item);
-        if (fn(eItem)) items.append(eItem);
+    for (int row = 0; row < this->m_list->count(); row++) {
+        auto eItem = this->item(row);
+        if (!eItem->isHeader() && fn(eItem)) items.append(eItem);
     }
     return items;
 }
@@ -389,39 +963,842 @@ QList<CEnhancedList::Item*> Widget::findItems(const QString& text, Qt::MatchFlag
     return items;
 }
 
-QList<CEnhancedList::Item*> Widget::selectedItems() const
+QVector<CEnhancedList::FuzzyMatch> Widget::fuzzyFind(const QString& pattern, int limit) const
 {
-    QList<Item*> items;
-    for (auto item: this->m_list->selectedItems()) {
-        items.append(static_cast<Item*>(item));
+    const QString needle = pattern.toLower();
+    const quint64 required = FuzzyMatcher::mask(needle);
+
+    // Cheap character-set prefilter on the GUI thread
+    QVector<int> rows;
+    QVector<QString> texts;
+    for (int row = 0; row < this->m_list->count(); row++) {
+        Item* item = this->item(row);
+        if (item->isHeader() || (item->charMask() & required) != required) continue;
+        rows.append(row);
+        texts.append(item->text());
     }
-    return items;
+
+    // Score candidates in parallel chunks; each chunk owns its slice of scores
+    const int chunkSize = 4096;
+    QVector<int> scores(rows.count(), -1);
+    int* out = scores.data();
+    QVector<int> chunks;
+    for (int start = 0; start < rows.count(); start += chunkSize) {
+        chunks.append(start);
+    }
+    auto scoreChunk = [&texts, &needle, out, chunkSize](int start) {
+        int end = qMin(start + chunkSize, texts.count());
+        for (int i = start; i < end; i++) {
+            out[i] = FuzzyMatcher::score(texts.at(i), needle);
+        }
+    };
+    if (chunks.count() > 1) QtConcurrent::blockingMap(chunks, scoreChunk);
+    else for (int start: chunks) scoreChunk(start);
+
+    QVector<FuzzyMatch> matches;
+    for (int i = 0; i < rows.count(); i++) {
+        if (scores.at(i) >= 0) matches.append(FuzzyMatch { this->item(rows.at(i)), rows.at(i), scores.at(i) });
+    }
+    auto better = [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        return a.score != b.score ? a.score > b.score : a.row < b.row;
+    };
+    if (limit >= 0 && limit < matches.count()) {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+        matches.erase(matches.begin() + limit, matches.end());
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
 }
 
-CEnhancedList::Item* Widget::takeItem(int row)
+bool Widget::exportRow(int row, const CEnhancedList::ExportOptions& options, ExportRow& out) const
 {
-    auto item = this->m_list->takeItem(row);
-    return static_cast<Item*>(item);
+    Item* item = this->item(row);
+    if (options.rows == ExportRows::Selected && !item->isSelected()) return false;
+    if (options.rows == ExportRows::Visible && item->m_hidden) return false;
+    out.text = options.transformed && !item->isHeader() ? item->transformedText() : item->text();
+    out.header = item->isHeader();
+    return true;
 }
 
-void Widget::onEditChanged()
+QVector<Widget::ExportRow> Widget::exportSnapshot(const CEnhancedList::ExportOptions& options) const
 {
-    this->resizeEvent(nullptr);
+    // Raw text is shared, not copied; only transformed output allocates
+    QVector<ExportRow> rows;
+    ExportRow row;
+    for (int i = 0; i < this->m_list->count(); i++) {
+        if (this->exportRow(i, options, row)) rows.append(row);
+    }
+    return rows;
 }
 
-void Widget::onCurrentItemChanged(QListWidgetItem* current, QListWidgetItem* previous)
+static void appendJsonString(QString& out, const QString& text)
 {
-    auto c = static_cast<Item*>(current);
-    auto p = static_cast<Item*>(previous);
-    emit this->currentItemChanged(c, p);
-    if (p != nullptr) p->redraw();
-    if (c != nullptr) c->redraw();
+    out.append('"');
+    for (QChar c: text) {
+        switch (c.unicode()) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c.unicode() < 0x20) out.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+            else out.append(c);
+        }
+    }
+    out.append('"');
 }
 
-void Widget::onItemActivated(QListWidgetItem* item)
+bool Widget::writeExport(QIODevice* device, int count, const std::function<bool(int, ExportRow&)>& rowAt, const CEnhancedList::ExportOptions& options)
 {
-    auto i = static_cast<Item*>(item);
-    emit this->itemActivated(i);
+    if (device == nullptr || !device->isWritable()) return false;
+
+    QString buffer;
+    buffer.reserve(options.chunkSize + 1024);
+    auto flush = [device, &buffer]() {
+        QByteArray bytes = buffer.toUtf8();
+        buffer.clear();
+        return device->write(bytes) == bytes.size();
+    };
+
+    bool first = true;
+    ExportRow row;
+    if (options.format == ExportFormat::Json) buffer.append('[');
+    for (int i = 0; i < count; i++) {
+        if (!rowAt(i, row)) continue;
+        switch (options.format) {
+        case ExportFormat::PlainText:
+            buffer.append(row.text);
+            buffer.append('\n');
+            break;
+        case ExportFormat::Markdown:
+            if (row.header) {
+                buffer.append(first ? "## " : "\n## ");
+                buffer.append(row.text);
+                buffer.append("\n\n");
+            } else {
+                buffer.append("- ");
+                buffer.append(QString(row.text).replace('\n', "\n  "));
+                buffer.append('\n');
+            }
+            break;
+        case ExportFormat::Json:
+            if (row.header) continue;
+            if (!first) buffer.append(',');
+            appendJsonString(buffer, row.text);
+            break;
+        }
+        first = false;
+        if (buffer.size() >= options.chunkSize && !flush()) return false;
+    }
+    if (options.format == ExportFormat::Json) buffer.append("]\n");
+    return flush();
+}
+
+bool Widget::exportTo(QIODevice* device, const CEnhancedList::ExportOptions& options) const
+{
+    // Rows are produced as they are written, so only one chunk is held at a time
+    return Widget::writeExport(device, this->m_list->count(), [this, &options](int i, ExportRow& row) {
+        return this->exportRow(i, options, row);
+    }, options);
+}
+
+QFuture<bool> Widget::exportAsync(QIODevice* device, const CEnhancedList::ExportOptions& options) const
+{
+    // The snapshot is taken here, on the GUI thread; only writing runs on the worker
+    QVector<ExportRow> rows = this->exportSnapshot(options);
+    return QtConcurrent::run([device, rows, options]() {
+        return Widget::writeExport(device, rows.count(), [&rows](int i, ExportRow& row) {
+            row = rows.at(i);
+            return true;
+        }, options);
+    });
+}
+
+CacheManager::CacheManager()
+{
+    this->m_budget = 0;
+}
+
+CacheManager* CacheManager::instance()
+{
+    static CacheManager manager;
+    return &manager;
+}
+
+CacheStats CacheManager::stats() const
+{
+    CacheStats stats;
+    for (Widget* widget: this->m_widgets) {
+        CacheStats s = widget->cacheStats();
+        stats.heightIndex += s.heightIndex;
+        stats.rowWidgets += s.rowWidgets;
+        stats.highlightedText += s.highlightedText;
+        stats.history += s.history;
+    }
+    return stats;
+}
+
+void CacheManager::trim()
+{
+    if (this->m_budget <= 0) return;
+    qint64 total = this->stats().total();
+    for (Widget* widget: this->m_widgets) {
+        if (total <= this->m_budget) break;
+        if (widget->isVisible() || widget->m_cachesReleased) continue;
+        qint64 before = widget->cacheStats().total();
+        widget->releaseCaches();
+        total -= before - widget->cacheStats().total();
+    }
+}
+
+bool Widget::checkConsistency(QString* error) const
+{
+    auto fail = [error](const QString& message) {
+        if (error != nullptr) *error = message;
+        return false;
+    };
+
+    const int count = this->m_list->count();
+    if (!this->m_heightsDirty && this->m_heights.count() != count) return fail("height index covers " + QString::number(this->m_heights.count()) + " rows, list has " + QString::number(count));
+
+    auto at = [](int row) { return " at row " + QString::number(row); };
+    int owner = -1;
+    for (int row = 0; row < count; row++) {
+        Item* item = this->item(row);
+        if (item == nullptr) return fail("missing item" + at(row));
+        if (this->row(item) != row) return fail("row index returns " + QString::number(this->row(item)) + at(row));
+        if (item->m_hidden != this->m_list->isRowHidden(row)) return fail("hidden state out of sync" + at(row));
+
+        QWidget* widget = this->m_list->itemWidget(item);
+        bool editor = qobject_cast<QPlainTextEdit*>(widget) != nullptr || qobject_cast<QLineEdit*>(widget) != nullptr;
+        if (item->isEditing() != editor) return fail("edit state does not match row widget" + at(row));
+
+        if (!this->m_heightsDirty && this->m_heights.height(row) != this->indexedHeight(row)) return fail("cached height differs from size hint" + at(row));
+
+        // Every row belongs to the last header above it
+        if (item->m_section >= this->m_sections.count()) return fail("unknown section" + at(row));
+        if (item->m_isHeader) {
+            if (item->m_section < 0 || this->m_sections.at(item->m_section).header != item) return fail("header not registered" + at(row));
+            if (item->m_section < owner) return fail("header out of order" + at(row));
+            owner = item->m_section;
+        } else if (item->m_section != owner) {
+            return fail("item outside its section" + at(row));
+        }
+    }
+
+    // Once the queued label pass has run, the rows it covers must have a widget
+    bool indexed = !this->hasPixelLayout() || (!this->m_heightsDirty && this->m_heights.count() == count);
+    if (this->isVisible() && !this->m_labelsPending && indexed) {
+        int visible = this->visibleRowBudget();
+        for (int row = this->firstVisibleRow(); row < count && visible > 0; row++) {
+            Item* item = this->item(row);
+            if (item->m_hidden) continue;
+            if (this->m_list->itemWidget(item) == nullptr) return fail("visible row has no label" + at(row));
+            visible--;
+        }
+    }
+
+    for (auto it = this->m_keys.constBegin(); it != this->m_keys.constEnd(); ++it) {
+        if (it.value()->key() != it.key()) return fail("key index entry '" + it.key() + "' points to an item keyed '" + it.value()->key() + "'");
+    }
+    return true;
+}
+
+CacheStats Widget::cacheStats() const
+{
+    // Running counters, so the cache manager can poll every widget cheaply
+    CacheStats stats;
+    stats.heightIndex = this->m_heights.memory();
+    stats.rowWidgets = this->m_widgetBytes;
+    stats.highlightedText = this->m_highlightedBytes;
+    stats.history = this->m_history.size();
+    return stats;
+}
+
+void Widget::releaseCaches()
+{
+    this->m_heights.clear();
+    this->m_heightsDirty = true;
+    for (int row = 0; row < this->m_list->count() && (this->m_widgetBytes > 0 || this->m_highlightedBytes > 0); row++) {
+        Item* item = this->item(row);
+        this->m_widgetBytes -= item->releaseLabel();
+        item->setHighlightedHtml(QString());
+    }
+    this->m_cachesReleased = true;
+}
+
+void Widget::onRowsAboutToBeRemoved(const QModelIndex& /*parent*/, int first, int last)
+{
+    // The view deletes the row widgets of removed rows. An item being destroyed is no longer
+    // an Item here; its destructor has already reported its caches
+    for (int row = first; row <= last; row++) {
+        Item* item = dynamic_cast<Item*>(this->m_list->item(row));
+        if (item == nullptr) continue;
+        this->m_widgetBytes -= item->m_widgetBytes;
+        item->m_widgetBytes = 0;
+    }
+}
+
+void Widget::trimCaches()
+{
+    if (this->m_memoryBudget > 0 && !this->isVisible() && !this->m_cachesReleased && this->cacheStats().total() > this->m_memoryBudget) {
+        this->releaseCaches();
+    }
+    CacheManager::instance()->trim();
+}
+
+void Widget::showEvent(QShowEvent* event)
+{
+    CacheManager::instance()->touch(this);
+    QWidget::showEvent(event);
+
+    // Size hints survive a release; the height index and labels come back on demand
+    this->m_cachesReleased = false;
+    this->ensureVisibleLabels();
+}
+
+void Widget::onRowsChanged()
+{
+    this->invalidateRows(0);
+}
+
+void Widget::invalidateRows(int first)
+{
+    this->m_heightsDirty = true;
+    this->m_rowsDirtyFrom = qMin(this->m_rowsDirtyFrom, qMax(0, first));
+    this->scheduleLabels();
+}
+
+void Widget::scheduleLabels()
+{
+    if (this->m_labelsPending) return;
+    this->m_labelsPending = true;
+
+    // The view lays rows out lazily too; lay them out first so the top row is current
+    QTimer::singleShot(0, this, [this]() {
+        if (this->isVisible() && this->m_labelsPending) this->m_list->doItemsLayout();
+        this->ensureVisibleLabels();
+    });
+}
+
+int Widget::firstVisibleRow() const
+{
+    if (this->hasPixelLayout() && !this->m_heightsDirty && this->m_heights.count() == this->m_list->count()) {
+        return qMax(0, this->m_heights.rowAt(this->m_list->verticalScrollBar()->value() - this->m_list->spacing()));
+    }
+    QModelIndex top = this->m_list->indexAt(QPoint(0, 0));
+    return top.isValid() ? top.row() : 0;
+}
+
+int Widget::visibleRowBudget() const
+{
+    // Rows are never shorter than one line, which bounds how many can be on screen
+    return this->m_list->viewport()->height() / qMax(1, this->m_list->fontMetrics().height()) + 2;
+}
+
+void Widget::ensureVisibleLabels()
+{
+    this->m_labelsPending = false;
+    if (!this->isVisible() || this->m_list->count() == 0) return;
+    if (this->hasPixelLayout()) this->ensureHeightIndex();
+
+    int visible = this->visibleRowBudget();
+    for (int row = this->firstVisibleRow(); row < this->m_list->count() && visible > 0; row++) {
+        Item* item = this->item(row);
+        if (item->m_hidden) continue;
+        this->m_widgetBytes += item->ensureLabel();
+        visible--;
+    }
+}
+
+void Widget::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    this->trimCaches();
+}
+
+QList<CEnhancedList::Item*> Widget::selectedItems() const
+{
+    QList<Item*> items;
+    for (auto item: this->m_list->selectedItems()) {
+        items.append(static_cast<Item*>(item));
+    }
+    return items;
+}
+
+void Widget::setRowHidden(int row, bool hide)
+{
+    Item* item = this->item(row);
+    if (item == nullptr) return;
+    item->m_hidden = hide;
+    this->m_list->setRowHidden(row, hide);
+    this->m_heightsDirty = true;
+    if (!hide) this->scheduleLabels();
+}
+
+void Widget::sortItems(Qt::SortOrder order)
+{
+    this->m_sortOrder = order;
+    for (int row = 0; row < this->m_list->count() && !this->m_sections.isEmpty(); row++) {
+        Item* item = this->item(row);
+        if (item->m_section < 0) continue;
+        item->m_sortRank = this->sectionRank(item->m_section, item->m_isHeader);
+    }
+    this->m_list->sortItems(order);
+    this->m_history.clear();
+}
+
+qint64 Widget::sectionRank(int section, bool header) const
+{
+    // Ranks keep sections in insertion order, headers on top, in both directions
+    qint64 base = 2 * qint64(section + 1);
+    if (this->m_sortOrder == Qt::AscendingOrder) return header ? base : base + 1;
+    return header ? 1 - base : -base;
+}
+
+int Widget::addSection(const QString& title)
+{
+    int section = this->m_sections.count();
+    Item* header = this->newItem();
+    header->m_section = section;
+    header->m_isHeader = true;
+    header->m_sortRank = this->sectionRank(section, true);
+    header->setFlags(Qt::ItemIsEnabled);
+    header->setTransformFn(nullptr);
+    header->setText(title);
+    header->redraw();
+    this->m_sections.append(Section { title, header, false });
+    connect(header, &Item::onHeaderReleased, this, &Widget::onSectionHeaderReleased);
+    this->updateItemHeight(header);
+    return section;
+}
+
+int Widget::sectionEnd(int section) const
+{
+    for (int next = section + 1; next < this->m_sections.count(); next++) {
+        int row = this->row(this->m_sections.at(next).header);
+        if (row >= 0) return row;
+    }
+    return this->m_list->count();
+}
+
+int Widget::sectionAt(int row) const
+{
+    // Headers keep section order, so the last live header at or above the row owns it
+    int owner = -1;
+    for (int section = 0; section < this->m_sections.count(); section++) {
+        int header = this->row(this->m_sections.at(section).header);
+        if (header > row) break;
+        if (header >= 0) owner = section;
+    }
+    return owner;
+}
+
+void Widget::adoptSection(int first, int count)
+{
+    for (int row = first; row < first + count; row++) {
+        Item* item = this->item(row);
+        int section = this->sectionAt(row);
+        if (item->m_isHeader || item->m_section == section) continue;
+        item->m_section = section;
+        item->m_sortRank = section < 0 ? 0 : this->sectionRank(section, false);
+        this->applyRowVisibility(row);
+    }
+}
+
+CEnhancedList::Item* Widget::addItem(int section, const QString& label)
+{
+    if (this->m_sections.at(section).header == nullptr) return this->addItem(label);
+    Item* item = this->newItem();
+    item->m_section = section;
+    item->m_sortRank = this->sectionRank(section, false);
+    item->setText(label);
+    this->placeNewItem(this->sectionEnd(section), item);
+    if (this->m_sections.at(section).collapsed) this->applyRowVisibility(this->row(item));
+    return item;
+}
+
+void Widget::applyRowVisibility(int row)
+{
+    Item* item = this->item(row);
+    bool hide = item->m_filtered || (item->m_section >= 0 && !item->m_isHeader && this->m_sections.at(item->m_section).collapsed);
+    if (hide == item->m_hidden) return;
+    item->m_hidden = hide;
+    this->m_list->setRowHidden(row, hide);
+    if (!hide) this->scheduleLabels();
+}
+
+void Widget::setSectionCollapsed(int section, bool collapsed)
+{
+    if (this->m_sections.at(section).collapsed == collapsed || this->m_sections.at(section).header == nullptr) return;
+    this->m_sections[section].collapsed = collapsed;
+
+    // Only the section's own range is visited, and measuring skips it while collapsed
+    int first = this->row(this->m_sections.at(section).header) + 1;
+    int end = this->sectionEnd(section);
+    int width = this->width() - this->contentsMargins().left() - this->contentsMargins().right();
+    this->m_list->setUpdatesEnabled(false);
+    for (int row = first; row < end; row++) {
+        Item* item = this->item(row);
+        if (item->m_section != section) continue;
+        this->applyRowVisibility(row);
+        if (!item->m_hidden) this->measureRow(row, width);
+    }
+    this->m_list->setUpdatesEnabled(true);
+    this->m_heightsDirty = true;
+}
+
+void Widget::clearSections()
+{
+    QVector<Section> sections = this->m_sections;
+    this->m_sections.clear();
+    for (const Section& section: sections) {
+        delete section.header;
+    }
+    for (int row = 0; row < this->m_list->count(); row++) {
+        Item* item = this->item(row);
+        item->m_section = -1;
+        item->m_sortRank = 0;
+        this->applyRowVisibility(row);
+    }
+    this->m_heightsDirty = true;
+    this->m_history.clear();
+}
+
+void Widget::filterItems(std::function<bool(CEnhancedList::Item*)> fn)
+{
+    this->m_list->setUpdatesEnabled(false);
+    for (int row = 0; row < this->m_list->count(); row++) {
+        Item* item = this->item(row);
+        item->m_filtered = fn && !item->m_isHeader && !fn(item);
+        this->applyRowVisibility(row);
+    }
+    this->m_list->setUpdatesEnabled(true);
+    this->m_heightsDirty = true;
+}
+
+int Widget::row(const CEnhancedList::Item* item) const
+{
+    if (item == nullptr || item->listWidget() != this->m_list) return -1;
+    int hint = item->m_row;
+    if (hint >= 0 && hint < this->m_list->count() && this->m_list->item(hint) == item) return hint;
+
+    // Rows above the low-water mark are known; refresh below it only as far as the item
+    for (; this->m_rowsDirtyFrom < this->m_list->count(); this->m_rowsDirtyFrom++) {
+        Item* current = this->item(this->m_rowsDirtyFrom);
+        current->m_row = this->m_rowsDirtyFrom;
+        if (current == item) return this->m_rowsDirtyFrom++;
+    }
+    return this->m_list->row(item);
+}
+
+CEnhancedList::Item* Widget::itemForKey(const QString& key) const
+{
+    Item* item = this->m_keys.value(key, nullptr);
+    return item != nullptr && item->listWidget() == this->m_list ? item : nullptr;
+}
+
+void Widget::setItemKey(CEnhancedList::Item* item, const QString& key)
+{
+    if (item->m_key == key) return;
+    if (!item->m_key.isNull() && this->m_keys.value(item->m_key) == item) this->m_keys.remove(item->m_key);
+    if (item->m_key.isNull()) connect(item, &Item::onKeyReleased, this, &Widget::onItemKeyReleased, Qt::UniqueConnection);
+    item->m_key = key;
+    if (!key.isNull()) this->m_keys.insert(key, item);
+}
+
+CEnhancedList::Item* Widget::takeItem(int row)
+{
+    if (this->item(row) != nullptr && this->item(row)->m_isHeader) return nullptr;
+    auto item = static_cast<Item*>(this->m_list->takeItem(row));
+    if (item != nullptr && !this->m_replaying) this->m_history.recordTake(row, item->text());
+    return item;
+}
+
+void Widget::undo()
+{
+    while (const EditHistory::Entry* entry = this->m_history.undo()) {
+        this->replay(*entry, true);
+        if (!entry->linked) break;
+    }
+}
+
+void Widget::redo()
+{
+    const EditHistory::Entry* entry = this->m_history.redo();
+    if (entry != nullptr) this->replay(*entry, false);
+    while (this->m_history.redoLinked()) {
+        this->replay(*this->m_history.redo(), false);
+    }
+}
+
+void Widget::replay(const EditHistory::Entry& entry, bool undo)
+{
+    this->m_replaying = true;
+    bool insert = (entry.action == EditHistory::Action::Insert) != undo;
+    switch (entry.action) {
+    case EditHistory::Action::Edit: {
+        Item* item = this->item(entry.row);
+        if (item == nullptr) break;
+        if (undo) item->setText(EditHistory::undone(entry, item->text(), this->m_history.removed(entry)));
+        else item->setText(EditHistory::redone(entry, item->text(), this->m_history.inserted(entry)));
+        this->updateItemHeight(item);
+        break;
+    }
+    case EditHistory::Action::Insert:
+    case EditHistory::Action::Take:
+        if (insert) {
+            QStringView text = entry.action == EditHistory::Action::Insert ? this->m_history.inserted(entry) : this->m_history.removed(entry);
+            Item* item = this->insertItem(entry.row, text.toString());
+            this->updateItemHeight(item);
+        } else {
+            delete this->takeItem(entry.row);
+        }
+        break;
+    case EditHistory::Action::Move:
+        if (undo) this->moveRowRange(entry.to, entry.count, entry.row);
+        else this->moveRowRange(entry.row, entry.count, entry.to);
+        break;
+    }
+    this->m_replaying = false;
+}
+
+bool Widget::moveRowRange(int from, int count, int to)
+{
+    if (this->m_list->isSortingEnabled()) return false;
+    to = qBound(0, to, this->m_list->count() - count);
+    if (from < 0 || count <= 0 || from == to) return false;
+    for (int row = from; row < from + count && !this->m_sections.isEmpty(); row++) {
+        if (this->item(row)->m_isHeader) return false;
+    }
+    if (!this->m_list->model()->moveRows(QModelIndex(), from, count, QModelIndex(), to > from ? to + count : to)) return false;
+    this->adoptSection(to, count);
+    return true;
+}
+
+bool Widget::moveRows(const QList<int>& sourceRows, int destinationRow)
+{
+    if (this->m_list->isSortingEnabled() || sourceRows.isEmpty()) return false;
+
+    QList<int> rows = sourceRows;
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    if (rows.first() < 0 || rows.last() >= this->m_list->count()) return false;
+    for (int row: rows) {
+        if (this->item(row)->m_isHeader) return false;
+    }
+    destinationRow = qBound(0, destinationRow, this->m_list->count());
+
+    // Split into contiguous runs, broken at the destination; each run is a single model move
+    QVector<QPair<int, int>> runs;
+    for (int row: rows) {
+        if (!runs.isEmpty() && runs.last().first + runs.last().second == row && row != destinationRow) runs.last().second++;
+        else runs.append(qMakePair(row, 1));
+    }
+
+    if (!this->m_replaying) this->m_history.beginGroup();
+    // Runs above the destination go last to first, each ending where the next one starts...
+    int position = destinationRow;
+    for (int i = runs.count() - 1; i >= 0; i--) {
+        if (runs.at(i).first >= destinationRow) continue;
+        int start = runs.at(i).first;
+        int count = runs.at(i).second;
+        position -= count;
+        if (this->moveRowRange(start, count, position) && !this->m_replaying) this->m_history.recordMove(start, count, position);
+    }
+    // ...runs below it go first to last, each following the previous one
+    position = destinationRow;
+    for (const auto& run: runs) {
+        if (run.first < destinationRow) continue;
+        if (this->moveRowRange(run.first, run.second, position) && !this->m_replaying) this->m_history.recordMove(run.first, run.second, position);
+        position += run.second;
+    }
+    if (!this->m_replaying) this->m_history.endGroup();
+    return true;
+}
+
+void Widget::setDragReorderEnabled(bool on)
+{
+    this->m_list->setDragEnabled(on);
+    this->m_list->setAcceptDrops(on);
+    this->m_list->setDropIndicatorShown(on);
+    this->m_list->setDefaultDropAction(on ? Qt::MoveAction : Qt::IgnoreAction);
+    this->m_list->setDragDropMode(on ? QAbstractItemView::InternalMove : QAbstractItemView::NoDragDrop);
+}
+
+bool Widget::eventFilter(QObject* obj, QEvent* event)
+{
+    if (obj != this->m_list->viewport() || event->type() != QEvent::Drop || !this->isDragReorderEnabled()) {
+        return QWidget::eventFilter(obj, event);
+    }
+    QDropEvent* dropEvent = static_cast<QDropEvent*>(event);
+    if (dropEvent->source() != this->m_list) return QWidget::eventFilter(obj, event);
+
+    int destination = this->m_list->count();
+    QModelIndex index = this->m_list->indexAt(dropEvent->pos());
+    if (index.isValid()) {
+        destination = index.row();
+        if (dropEvent->pos().y() >= this->m_list->visualRect(index).center().y()) destination++;
+    }
+
+    QList<int> rows;
+    for (const QModelIndex& selected: this->m_list->selectionModel()->selectedIndexes()) {
+        rows.append(selected.row());
+    }
+    this->moveRows(rows, destination);
+
+    // Report a copy so the view does not remove the dragged rows afterwards
+    dropEvent->setDropAction(Qt::CopyAction);
+    dropEvent->accept();
+    this->m_list->viewport()->update();
+    return true;
+}
+
+bool Widget::applyItems(const QStringList& labels, std::function<QString(const QString&)> keyFn)
+{
+    if (!this->m_sections.isEmpty()) return false;
+    if (!keyFn) keyFn = [](const QString& label){ return label; };
+
+    bool sorting = this->m_list->isSortingEnabled();
+    int scroll = this->m_list->verticalScrollBar()->value();
+    this->m_list->setSortingEnabled(false);
+    this->m_list->setUpdatesEnabled(false);
+
+    // Match current rows to new rows by key; duplicates pair up in order
+    QMultiHash<QString, int> pending;
+    pending.reserve(labels.count());
+    for (int i = labels.count() - 1; i >= 0; i--) {
+        pending.insert(keyFn(labels.at(i)), i);
+    }
+    QVector<int> targets(this->m_list->count(), -1);
+    QVector<bool> matched(labels.count(), false);
+    for (int row = 0; row < targets.count(); row++) {
+        auto it = pending.find(keyFn(this->item(row)->text()));
+        if (it == pending.end()) continue;
+        targets[row] = it.value();
+        matched[it.value()] = true;
+        pending.erase(it);
+    }
+
+    // Remove unmatched rows, one model call per contiguous run
+    QAbstractItemModel* model = this->m_list->model();
+    int row = targets.count() - 1;
+    while (row >= 0) {
+        if (targets.at(row) >= 0) { row--; continue; }
+        int last = row;
+        while (row >= 0 && targets.at(row) < 0) row--;
+        model->removeRows(row + 1, last - row);
+    }
+    targets.erase(std::remove(targets.begin(), targets.end(), -1), targets.end());
+
+    // Rows on the longest increasing run of targets stay; the others move
+    QVector<int> tails;
+    QVector<int> parents(targets.count(), -1);
+    for (int i = 0; i < targets.count(); i++) {
+        auto pos = std::lower_bound(tails.begin(), tails.end(), i, [&targets](int a, int b){ return targets.at(a) < targets.at(b); });
+        if (pos != tails.begin()) parents[i] = *(pos - 1);
+        if (pos == tails.end()) tails.append(i);
+        else *pos = i;
+    }
+    QVector<bool> stays(targets.count(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = parents.at(i)) {
+        stays[i] = true;
+    }
+
+    QVector<Item*> kept(targets.count());
+    QVector<int> byTarget(targets.count());
+    for (int i = 0; i < targets.count(); i++) {
+        kept[i] = this->item(i);
+        byTarget[i] = i;
+    }
+    std::sort(byTarget.begin(), byTarget.end(), [&targets](int a, int b){ return targets.at(a) < targets.at(b); });
+
+    // Movers go right after their predecessor in target order. Current positions are prefix
+    // sums over slots: slot 0 counts rows placed at the front, slot i + 1 the kept row i plus
+    // the movers placed after it
+    HeightIndex positions;
+    QVector<int> weights(targets.count() + 1, 1);
+    weights[0] = 0;
+    positions.build(weights);
+    int anchor = 0;
+    int k = 0;
+    while (k < byTarget.count()) {
+        int i = byTarget.at(k);
+        if (stays.at(i)) {
+            anchor = i + 1;
+            k++;
+            continue;
+        }
+        // Movers that are adjacent now and consecutive in target order move as one run
+        int count = 1;
+        while (k + count < byTarget.count() && byTarget.at(k + count) == i + count && !stays.at(i + count)) count++;
+        int from = positions.offset(i + 1);
+        int insert = positions.offset(anchor) + positions.height(anchor);
+        this->moveRowRange(from, count, insert > from ? insert - count : insert);
+        for (int j = i; j < i + count; j++) {
+            positions.setHeight(j + 1, 0);
+        }
+        positions.setHeight(anchor, positions.height(anchor) + count);
+        k += count;
+    }
+
+    // Insert new rows in ascending order so every target row is final; each run is one move
+    QVector<int> changed;
+    int next = 0;
+    while (next < labels.count()) {
+        if (matched.at(next)) {
+            next++;
+            continue;
+        }
+        int first = next;
+        for (; next < labels.count() && !matched.at(next); next++) {
+            this->newItem(labels.at(next));
+            changed.append(next);
+        }
+        this->moveRowRange(this->m_list->count() - (next - first), next - first, first);
+    }
+    for (int i = 0; i < kept.count(); i++) {
+        const QString& label = labels.at(targets.at(i));
+        if (kept.at(i)->text() == label) continue;
+        kept.at(i)->setText(label);
+        changed.append(targets.at(i));
+    }
+
+    int width = this->width() - this->contentsMargins().left() - this->contentsMargins().right();
+    for (int changedRow: changed) {
+        this->measureRow(changedRow, width);
+    }
+    this->m_heightsDirty = true;
+
+    this->m_history.clear();
+    this->m_list->setSortingEnabled(sorting);
+    this->m_list->setUpdatesEnabled(true);
+    this->m_list->verticalScrollBar()->setValue(scroll);
+    return true;
+}
+
+void Widget::onEditChanged()
+{
+    Item* item = qobject_cast<Item*>(this->sender());
+    if (item == nullptr) this->resizeEvent(nullptr);
+    else this->updateItemHeight(item);
+}
+
+void Widget::onCurrentItemChanged(QListWidgetItem* current, QListWidgetItem* previous)
+{
+    auto c = static_cast<Item*>(current);
+    auto p = static_cast<Item*>(previous);
+    emit this->currentItemChanged(c, p);
+    if (p != nullptr) p->redraw();
+    if (c != nullptr) c->redraw();
+}
+
+void Widget::onItemActivated(QListWidgetItem* item)
+{
+    auto i = static_cast<Item*>(item);
+    emit this->itemActivated(i);
 }
 
 void Widget::onItemChanged(QListWidgetItem* item)
@@ -434,6 +1811,7 @@ void Widget::onItemChanged(QListWidgetItem* item)
 void Widget::onItemClicked(QListWidgetItem* item)
 {
     auto i = static_cast<Item*>(item);
+    if (i != nullptr && i->isHeader()) this->toggleSection(i->section());
     emit this->itemClicked(i);
 }
 
@@ -467,7 +1845,39 @@ void Widget::onItemPressed(QListWidgetItem* item)
 
 void Widget::onItemEdited()
 {
-    emit this->itemEdited(this->currentItem());
+    Item* item = qobject_cast<Item*>(this->sender());
+    emit this->itemEdited(item != nullptr ? item : this->currentItem());
+}
+
+void Widget::onItemCacheChanged(qint64 rowWidget, qint64 highlighted)
+{
+    this->m_widgetBytes += rowWidget;
+    this->m_highlightedBytes += highlighted;
+}
+
+void Widget::onItemKeyReleased(const QString& key)
+{
+    if (this->m_keys.value(key) == this->sender()) this->m_keys.remove(key);
+}
+
+void Widget::onSectionHeaderReleased(int section)
+{
+    if (section < 0 || section >= this->m_sections.count() || this->m_sections.at(section).header != this->sender()) return;
+
+    // The section keeps its index so later sections stay valid; its rows join the one above
+    this->m_sections[section].header = nullptr;
+    this->m_sections[section].collapsed = false;
+    for (int row = 0; row < this->m_list->count(); row++) {
+        if (this->item(row)->m_section == section && !this->item(row)->m_isHeader) this->adoptSection(row, 1);
+    }
+    this->m_heightsDirty = true;
+}
+
+void Widget::onItemReplaced(const QString& previous)
+{
+    Item* item = qobject_cast<Item*>(this->sender());
+    if (item == nullptr || this->m_replaying) return;
+    this->m_history.recordEdit(this->row(item), previous, item->text());
 }
 
 void Widget::resize()
@@ -477,32 +1887,128 @@ void Widget::resize()
 
 void Widget::resizeEvent(QResizeEvent* /*e*/)
 {
-    int row = 0;
-    while (row < this->m_list->count()) {
-        QListWidgetItem* item = this->m_list->item(row);
-        Item* enhancedItem = static_cast<Item*>(item);
-        QWidget* itemWidget = this->m_list->itemWidget(item);
+    int width = this->width() - this->contentsMargins().left() - this->contentsMargins().right();
+    QVector<int> heights(this->m_list->count(), 0);
+    for (int row = 0; row < this->m_list->count(); row++) {
+        Item* item = this->item(row);
+        if (item->m_hidden) continue;
+        this->measureRow(row, width);
+        heights[row] = this->indexedHeight(row);
+        if (item->m_isHeader && this->m_sections.at(item->m_section).collapsed) {
+            row = this->sectionEnd(item->m_section) - 1;
+        }
+    }
+    this->m_heights.build(heights);
+    this->m_heightsDirty = false;
+    this->ensureVisibleLabels();
+}
 
-        int width = this->width() - this->contentsMargins().left() - this->contentsMargins().right();
-        int height = enhancedItem->heightForWidth(width);
-        QSize size = QSize(width, height);
+int Widget::measureRow(int row, int width)
+{
+    Item* item = this->item(row);
+    int height = item->heightForWidth(width);
+    QSize size = QSize(width, height);
+
+    // Decided from item state, so rows whose label was released still get a hint
+    if (item->isEditing()) {
+        size.setHeight(size.height() + 4);
+        item->setSizeHint(size);
+    } else if (item->wordWrap()) {
+        item->setSizeHint(size);
+    }
+    return size.height();
+}
 
-        QLabel* label = static_cast<QLabel*>(itemWidget);
-        if (label != nullptr && label->wordWrap()) {
-            item->setSizeHint(size);
-        }
-        QPlainTextEdit* edit = static_cast<QPlainTextEdit*>(itemWidget);
-        if (edit != nullptr) {
-            size.setHeight(size.height() + 4);
-            item->setSizeHint(size);
-        }
-        QLineEdit* editLine = static_cast<QLineEdit*>(itemWidget);
-        if (editLine != nullptr) {
-            size.setHeight(size.height() + 4);
-            item->setSizeHint(size);
-        }
-        row += 1;
+int Widget::indexedHeight(int row) const
+{
+    if (this->item(row)->m_hidden) return 0;
+    QSize hint = this->m_list->item(row)->sizeHint();
+    int height = hint.isValid() ? hint.height() : this->m_list->sizeHintForRow(row);
+    return height + this->m_list->spacing();
+}
+
+void Widget::ensureHeightIndex()
+{
+    if (!this->m_heightsDirty && this->m_heights.count() == this->m_list->count()) return;
+    QVector<int> heights(this->m_list->count());
+    for (int row = 0; row < this->m_list->count(); row++) {
+        heights[row] = this->indexedHeight(row);
+    }
+    this->m_heights.build(heights);
+    this->m_heightsDirty = false;
+}
+
+bool Widget::hasPixelLayout() const
+{
+    return this->m_list->verticalScrollMode() == QAbstractItemView::ScrollPerPixel
+            && this->m_list->flow() == QListView::TopToBottom
+            && !this->m_list->isWrapping();
+}
+
+void Widget::updateItemHeight(CEnhancedList::Item* item)
+{
+    int row = this->row(item);
+    if (row < 0) return;
+    int width = this->width() - this->contentsMargins().left() - this->contentsMargins().right();
+    this->measureRow(row, width);
+    if (!this->m_heightsDirty && this->m_heights.count() == this->m_list->count()) {
+        this->m_heights.setHeight(row, this->indexedHeight(row));
+    }
+}
+
+int Widget::rowAtOffset(int y)
+{
+    this->ensureHeightIndex();
+    return this->m_heights.rowAt(y - this->m_list->spacing());
+}
+
+int Widget::rowOffset(int row)
+{
+    this->ensureHeightIndex();
+    return this->m_list->spacing() + this->m_heights.offset(row);
+}
+
+CEnhancedList::Item* Widget::itemAt(const QPoint& p) const
+{
+    if (!this->hasPixelLayout() || this->m_heightsDirty || !this->m_list->viewport()->rect().contains(p)) {
+        return static_cast<Item*>(this->m_list->itemAt(p));
+    }
+    int row = this->m_heights.rowAt(p.y() + this->m_list->verticalScrollBar()->value() - this->m_list->spacing());
+    return row < 0 ? nullptr : this->item(row);
+}
+
+void Widget::scrollToItem(const CEnhancedList::Item* item, QAbstractItemView::ScrollHint hint)
+{
+    if (!this->hasPixelLayout()) {
+        this->m_list->scrollToItem(item, hint);
+        return;
+    }
+    int row = this->row(item);
+    if (row < 0) return;
+
+    this->ensureHeightIndex();
+    QScrollBar* bar = this->m_list->verticalScrollBar();
+    int top = this->m_list->spacing() + this->m_heights.offset(row);
+    int height = this->m_heights.height(row);
+    int viewport = this->m_list->viewport()->height();
+    int value = bar->value();
+
+    switch (hint) {
+    case QAbstractItemView::EnsureVisible:
+        if (top < value) value = top;
+        else if (top + height > value + viewport) value = top + height - viewport;
+        break;
+    case QAbstractItemView::PositionAtTop:
+        value = top;
+        break;
+    case QAbstractItemView::PositionAtBottom:
+        value = top + height - viewport;
+        break;
+    case QAbstractItemView::PositionAtCenter:
+        value = top + (height - viewport) / 2;
+        break;
     }
+    bar->setValue(value);
 }
 
 bool Widget::event(QEvent* event)
@@ -4,20 +4,152 @@
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QPlainTextEdit>
+#include <QSyntaxHighlighter>
+#include <QTimer>
 
 #include <QLabel>
+#include <QFuture>
+#include <QIODevice>
 
 namespace CEnhancedList
 {
 
+    enum class TextOwnership
+    {
+        Copy,       // deep copy of the viewed characters
+        External    // reference the caller buffer, which must outlive the item
+    };
+
+
+    // Prefix sums of row heights (Fenwick tree): O(log N) update and lookup
+    class HeightIndex
+    {
+    public:
+        void build(const QVector<int>& heights);
+        void clear() { this->m_heights.clear(); this->m_tree.clear(); }
+
+        int count() const { return this->m_heights.count(); }
+        qint64 memory() const { return (this->m_heights.capacity() + this->m_tree.capacity()) * qint64(sizeof(int)); }
+        int height(int row) const { return this->m_heights.at(row); }
+        void setHeight(int row, int height);
+
+        int offset(int row) const;
+        int total() const { return this->offset(this->count()); }
+        int rowAt(int y) const;
+
+    private:
+        QVector<int> m_heights;
+        QVector<int> m_tree;
+    };
+
+
+    // Undo/redo entries stored as deltas; all text lives in one arena string
+    class EditHistory
+    {
+    public:
+        enum class Action { Edit, Insert, Take, Move };
+
+        struct Entry
+        {
+            Action action;
+            int row;
+            int to;
+            int prefix;
+            int offset;
+            int removedLength;
+            int insertedLength;
+            int count;
+            bool linked;
+        };
+
+        EditHistory();
+
+        int maximumDepth() const { return this->m_maximumDepth; }
+        void setMaximumDepth(int depth) { this->m_maximumDepth = depth; this->trim(); }
+        qint64 maximumSize() const { return this->m_maximumSize; }
+        void setMaximumSize(qint64 bytes) { this->m_maximumSize = bytes; this->trim(); }
+        qint64 size() const { return this->m_arena.size() * qint64(sizeof(QChar)) + this->m_entries.size() * qint64(sizeof(Entry)); }
+
+        void recordEdit(int row, const QString& before, const QString& after);
+        void recordInsert(int row, const QString& text);
+        void recordTake(int row, const QString& text);
+        void recordMove(int from, int count, int to);
+
+        bool fits(int entries, qint64 length) const { return entries <= this->m_maximumDepth && entries * qint64(sizeof(Entry)) + length * qint64(sizeof(QChar)) <= this->m_maximumSize; }
+        void beginGroup() { this->m_grouping = true; this->m_groupStarted = false; }
+        void endGroup() { this->m_grouping = false; }
+
+        bool canUndo() const { return this->m_cursor > 0; }
+        bool canRedo() const { return this->m_cursor < this->m_entries.count(); }
+        const Entry* undo() { return this->canUndo() ? &this->m_entries.at(--this->m_cursor) : nullptr; }
+        const Entry* redo() { return this->canRedo() ? &this->m_entries.at(this->m_cursor++) : nullptr; }
+        bool redoLinked() const { return this->canRedo() && this->m_entries.at(this->m_cursor).linked; }
+        void clear();
+
+        QStringView removed(const Entry& entry) const { return QStringView(this->m_arena).mid(entry.offset, entry.removedLength); }
+        QStringView inserted(const Entry& entry) const { return QStringView(this->m_arena).mid(entry.offset + entry.removedLength, entry.insertedLength); }
+
+        static QString undone(const Entry& entry, const QString& current, QStringView removed);
+        static QString redone(const Entry& entry, const QString& current, QStringView inserted);
+
+    private:
+        void append(const Entry& entry, QStringView removed, QStringView inserted);
+        void trim();
+
+        QVector<Entry> m_entries;
+        QString m_arena;
+        int m_cursor;
+        bool m_grouping;
+        bool m_groupStarted;
+        int m_maximumDepth;
+        qint64 m_maximumSize;
+    };
+
+
+    // Command palette style matching: case-insensitive subsequence with bonuses
+    class FuzzyMatcher
+    {
+    public:
+        static quint64 mask(QStringView text);
+        static int score(QStringView text, QStringView pattern);
+    };
+
+
+    class Item;
+
+    // Everything an item needs, applied at once; the row label is created on first display
+    struct ItemOptions
+    {
+        QString text;
+        int margin = 5;
+        bool wordWrap = true;
+        Qt::TextFormat format = Qt::PlainText;
+        bool editable = false;
+        std::function<QString(Item*)> transformFn;
+        std::function<QSyntaxHighlighter*(QTextDocument*)> highlighterFn;
+        QString colorEditBackground = "#FFFFFF";
+        QString colorEditForeground = "#000000";
+        QString colorEditBorder = "#000000";
+        QString colorReadForegroundDefault = "#000000";
+        QString colorReadForegroundSelected = "#000000";
+    };
+
+
     class ItemEventFilter : public QObject
     {
         Q_OBJECT
 
     public:
-        explicit ItemEventFilter(): QObject(nullptr) {}
+        explicit ItemEventFilter(QObject* parent = nullptr): QObject(parent) { s_instances++; }
+        ~ItemEventFilter() { s_instances--; }
         bool eventFilter(QObject* obj, QEvent* event);
 
+        // Live filters, one per open editor; used to spot leaks
+        static int instances() { return s_instances; }
+
+    private:
+        static int s_instances;
+
     signals:
         void stopEdit();
         void saveEdit();
@@ -31,9 +163,13 @@ namespace CEnhancedList
 
     public:
         Item(QListWidget* parent = nullptr);
+        Item(QListWidget* parent, const ItemOptions& options);
+        ~Item();
 
         QString text() const { return this->m_text; }
         void setText(const QString& text);
+        void setText(QString&& text);
+        void setText(QStringView text, TextOwnership ownership);
 
         int margin() const { return this->m_margin; }
         void setMargin(int margin);
@@ -49,7 +185,9 @@ namespace CEnhancedList
 
         bool isEditing() const { return this->m_isEditing; }
 
+        // An empty function shows the text as is
         void setTransformFn(std::function<QString(Item*)> fn) { this->m_transformFn = fn; }
+        void setHighlighterFn(std::function<QSyntaxHighlighter*(QTextDocument*)> fn) { this->m_highlighterFn = fn; }
 
         void redraw();
 
@@ -62,10 +200,35 @@ namespace CEnhancedList
             this->m_colorReadForegroundSelected = readFgS;
         }
 
+        QString key() const { return this->m_key; }
+        quint64 charMask() const;
+
+        int section() const { return this->m_section; }
+        bool isHeader() const { return this->m_isHeader; }
+        qint64 sortRank() const { return this->m_sortRank; }
+
         virtual bool operator <(const QListWidgetItem& other) const;
 
     private:
+        friend class Widget;
+
         QListWidget* m_parent;
+        mutable int m_row;
+        mutable quint64 m_charMask;
+        mutable bool m_charMaskValid;
+        QString m_key;
+
+        QLabel* newLabel();
+        QString labelStyle() const;
+        qint64 ensureLabel();
+        qint64 releaseLabel();
+        qint64 m_widgetBytes;
+
+        int m_section;
+        bool m_isHeader;
+        bool m_hidden;
+        bool m_filtered;
+        qint64 m_sortRank;
 
         bool m_isEditing;
         QString m_editText;
@@ -81,9 +244,22 @@ namespace CEnhancedList
         Qt::TextFormat m_format;
 
         std::function<QString(Item*)> m_transformFn;
+        std::function<QSyntaxHighlighter*(QTextDocument*)> m_highlighterFn;
+        QSyntaxHighlighter* m_highlighter;
+        QTimer* m_editTimer;
+        QString m_highlightedHtml;
+        bool m_highlighted;
+
+        void redrawText();
+        QString transformedText();
+        void applyLabelText(QLabel* label);
+        void rehighlight();
+        void setHighlightedHtml(const QString& html);
+        static QString highlightedHtml(QTextDocument* document);
 
     private slots:
         void onEditChanged();
+        void onEditSettled();
         void onEditLineChanged();
         void onEditStopped();
         void onEditSaved();
@@ -92,6 +268,69 @@ namespace CEnhancedList
     signals:
         void onChanged();
         void onEdited();
+        void onReplaced(const QString& previous);
+        void onKeyReleased(const QString& key);
+        void onHeaderReleased(int section);
+        void onCacheChanged(qint64 rowWidget, qint64 highlighted);
+    };
+
+
+    enum class ExportFormat { PlainText, Markdown, Json };
+    enum class ExportRows { All, Selected, Visible };
+
+    struct ExportOptions
+    {
+        ExportFormat format = ExportFormat::PlainText;
+        ExportRows rows = ExportRows::All;
+        bool transformed = false;       // transform function output instead of raw text
+        int chunkSize = 64 * 1024;      // characters buffered before each device write
+    };
+
+
+    // Estimated bytes held by each releasable cache of a widget
+    struct CacheStats
+    {
+        qint64 heightIndex = 0;
+        qint64 rowWidgets = 0;
+        qint64 highlightedText = 0;
+        qint64 history = 0;
+
+        qint64 total() const { return this->heightIndex + this->rowWidgets + this->highlightedText + this->history; }
+    };
+
+
+    class Widget;
+
+    // Process-wide budget: hidden widgets are trimmed first, least recently shown first
+    class CacheManager
+    {
+    public:
+        static CacheManager* instance();
+
+        qint64 budget() const { return this->m_budget; }
+        void setBudget(qint64 bytes) { this->m_budget = bytes; this->trim(); }
+
+        CacheStats stats() const;
+        void trim();
+
+    private:
+        friend class Widget;
+
+        CacheManager();
+        void registerWidget(Widget* widget) { this->m_widgets.append(widget); }
+        void unregisterWidget(Widget* widget) { this->m_widgets.removeAll(widget); }
+        void touch(Widget* widget) { this->m_widgets.removeAll(widget); this->m_widgets.append(widget); }
+
+        QList<Widget*> m_widgets;
+        qint64 m_budget;
+    };
+
+
+    struct FuzzyMatch
+    {
+        CEnhancedList::Item* item;
+        int row;
+        int score;
     };
 
 
@@ -132,9 +371,9 @@ namespace CEnhancedList
         bool isWrapping() const { return this->m_list->isWrapping(); }
         Qt::Alignment itemAlignment() const { return this->m_list->itemAlignment(); }
         void setItemAlignment(Qt::Alignment alignment) { this->m_list->setItemAlignment(alignment); }
-        void setRowHidden(int row, bool hide) { this->m_list->setRowHidden(row, hide); }
+        void setRowHidden(int row, bool hide);
         void setSelectionRectVisible(bool show) { this->m_list->setSelectionRectVisible(show); }
-        void setSpacing(int space) { this->m_list->setSpacing(space); }
+        void setSpacing(int space) { this->m_list->setSpacing(space); this->m_heightsDirty = true; }
         void setUniformItemSizes(bool enable) { this->m_list->setUniformItemSizes(enable); }
         void setWordWrap(bool on) { this->m_list->setWordWrap(on); }
         void setWrapping(bool enable) { this->m_list->setWrapping(enable); }
@@ -146,21 +385,25 @@ namespace CEnhancedList
         CEnhancedList::Item* addItem(const QString& label);
         CEnhancedList::Item* addItem(CEnhancedList::Item* item);
         QList<CEnhancedList::Item*> addItems(const QStringList& labels);
+        CEnhancedList::Item* addItem(QStringView label, TextOwnership ownership);
+        QList<CEnhancedList::Item*> addItems(const QVector<QStringView>& labels, TextOwnership ownership);
+        QList<CEnhancedList::Item*> addItems(QStringView buffer, QChar separator, TextOwnership ownership);
         int count() const { return this->m_list->count(); }
         CEnhancedList::Item* currentItem() const { return this->m_list == nullptr ? nullptr : static_cast<Item*>(this->m_list->currentItem()); }
         int currentRow() const { return this->m_list->currentRow(); }
         // TODO void editItem(QListWidgetItem *item)
         QList<CEnhancedList::Item*> findItems(std::function<bool(CEnhancedList::Item*)> fn) const;
         QList<CEnhancedList::Item*> findItems(const QString& text, Qt::MatchFlags flags) const;
+        QVector<CEnhancedList::FuzzyMatch> fuzzyFind(const QString& pattern, int limit = -1) const;
         CEnhancedList::Item* insertItem(int row, CEnhancedList::Item* item);
         CEnhancedList::Item* insertItem(int row, const QString& label);
         QList<CEnhancedList::Item*> insertItems(int row, const QStringList& labels);
         bool isSortingEnabled() const { return this->m_list->isSortingEnabled(); }
         CEnhancedList::Item* item(int row) const { return static_cast<CEnhancedList::Item*>(this->m_list->item(row)); }
-        CEnhancedList::Item* itemAt(const QPoint& p) const { return static_cast<CEnhancedList::Item*>(this->m_list->itemAt(p)); }
-        CEnhancedList::Item* itemAt(int x, int y) const { return static_cast<CEnhancedList::Item*>(this->m_list->itemAt(x, y)); }
+        CEnhancedList::Item* itemAt(const QPoint& p) const;
+        CEnhancedList::Item* itemAt(int x, int y) const { return this->itemAt(QPoint(x, y)); }
         //QList<CEnhancedList::Item*> items(const QMimeData* data) const;
-        int row(const CEnhancedList::Item* item) const { return this->m_list->row(item); }
+        int row(const CEnhancedList::Item* item) const;
         QList<CEnhancedList::Item*> selectedItems() const;
         void setCurrentItem(CEnhancedList::Item* item) { this->m_list->setCurrentItem(item); }
         void setCurrentItem(CEnhancedList::Item* item, QItemSelectionModel::SelectionFlags command) { this->m_list->setCurrentItem(item, command); }
@@ -168,8 +411,64 @@ namespace CEnhancedList
         void setCurrentRow(int row, QItemSelectionModel::SelectionFlags command) { this->m_list->setCurrentRow(row, command); }
         void setSelectionModel(QItemSelectionModel* selectionModel) { this->m_list->setSelectionModel(selectionModel); }
         void setSortingEnabled(bool enable) { this->m_list->setSortingEnabled(enable); }
-        void sortItems(Qt::SortOrder order = Qt::AscendingOrder) { this->m_list->sortItems(order); }
+        void sortItems(Qt::SortOrder order = Qt::AscendingOrder);
+        // Header rows cannot be taken; returns nullptr for them
         CEnhancedList::Item* takeItem(int row);
+        // Moved rows join the section they land in; moves that include a header are refused
+        bool moveRows(const QList<int>& sourceRows, int destinationRow);
+
+        // Reconciles the rows with labels, matching existing items by keyFn(label). Refused with
+        // false while sections exist; call clearSections() first
+        bool applyItems(const QStringList& labels, std::function<QString(const QString&)> keyFn = {});
+
+        // SECTIONS
+        // A row belongs to the nearest header above it, including rows added or replayed there.
+        // Deleting a header drops its section: the header becomes null and its rows join the one above
+        int addSection(const QString& title);
+        int sectionCount() const { return this->m_sections.count(); }
+        QString sectionTitle(int section) const { return this->m_sections.at(section).title; }
+        CEnhancedList::Item* sectionHeader(int section) const { return this->m_sections.at(section).header; }
+        CEnhancedList::Item* addItem(int section, const QString& label);
+        bool isSectionCollapsed(int section) const { return this->m_sections.at(section).collapsed; }
+        void setSectionCollapsed(int section, bool collapsed);
+        void toggleSection(int section) { this->setSectionCollapsed(section, !this->isSectionCollapsed(section)); }
+        void clearSections();
+        void filterItems(std::function<bool(CEnhancedList::Item*)> fn);
+
+        // EXPORT
+        bool exportTo(QIODevice* device, const CEnhancedList::ExportOptions& options = CEnhancedList::ExportOptions()) const;
+        // Snapshots the rows, then writes the device from a worker thread. A transformed snapshot
+        // holds every transformed row (O(N)); the device and any TextOwnership::External buffers
+        // must stay valid and untouched until the returned future finishes
+        QFuture<bool> exportAsync(QIODevice* device, const CEnhancedList::ExportOptions& options = CEnhancedList::ExportOptions()) const;
+
+        // DIAGNOSTICS
+        bool checkConsistency(QString* error = nullptr) const;
+
+        // CACHES
+        qint64 memoryBudget() const { return this->m_memoryBudget; }
+        void setMemoryBudget(qint64 bytes) { this->m_memoryBudget = bytes; this->trimCaches(); }
+        CEnhancedList::CacheStats cacheStats() const;
+        void releaseCaches();
+        void trimCaches();
+        void ensureVisibleLabels();
+
+        // KEYS
+        CEnhancedList::Item* itemForKey(const QString& key) const;
+        void setItemKey(CEnhancedList::Item* item, const QString& key);
+
+        // HISTORY
+        // Rows are replayed from their text only: undoing an insert deletes the item, and redo or
+        // undoing a take creates a new one, so keys, flags and payloads are not restored
+        bool canUndo() const { return this->m_history.canUndo(); }
+        bool canRedo() const { return this->m_history.canRedo(); }
+        void undo();
+        void redo();
+        void clearHistory() { this->m_history.clear(); }
+        int historyDepth() const { return this->m_history.maximumDepth(); }
+        void setHistoryDepth(int depth) { this->m_history.setMaximumDepth(depth); }
+        qint64 historySize() const { return this->m_history.maximumSize(); }
+        void setHistorySize(qint64 bytes) { this->m_history.setMaximumSize(bytes); }
 
         // WIDGET
 
@@ -178,6 +477,9 @@ namespace CEnhancedList
         int margin() const { return this->m_margin; }
         void setMargin(int margin) { this->m_margin = margin; }
 
+        bool isDragReorderEnabled() const { return this->m_list->dragDropMode() == QAbstractItemView::InternalMove; }
+        void setDragReorderEnabled(bool on);
+
         bool isEditable() const { return this->m_editable; }
         void setEditable(bool on) { this->m_editable = on; }
 
@@ -188,10 +490,12 @@ namespace CEnhancedList
         void setPlainTextFormat() { this->setFormat(Qt::PlainText); }
 
         void setTransformFn(std::function<QString(Item*)> fn) { this->m_transformFn = fn; }
+        void setHighlighterFn(std::function<QSyntaxHighlighter*(QTextDocument*)> fn) { this->m_highlighterFn = fn; }
 
         // SLOTS QLISTWIGET
-        void clear() { this->m_list->clear(); }
-        void scrollToItem(const CEnhancedList::Item* item, QAbstractItemView::ScrollHint hint = QListWidget::EnsureVisible) { this->m_list->scrollToItem(item, hint); }
+        // Sections go first so the deleted headers do not try to drop them one by one
+        void clear() { this->m_sections.clear(); this->m_list->clear(); this->m_history.clear(); }
+        void scrollToItem(const CEnhancedList::Item* item, QAbstractItemView::ScrollHint hint = QListWidget::EnsureVisible);
 
         // SLOTS
         void clearSelection() { this->m_list->clearSelection(); }
@@ -201,6 +505,9 @@ namespace CEnhancedList
 
         // OTHER
         void resize();
+        void updateItemHeight(CEnhancedList::Item* item);
+        int rowAtOffset(int y);
+        int rowOffset(int row);
         void setColorEditBackground(const QString& color) { this->m_colorEditBackground = color; }
         void setColorEditForeground(const QString& color) { this->m_colorEditForeground = color; }
         void setColorEditBorder(const QString& color) { this->m_colorEditBorder = color; }
@@ -217,10 +524,18 @@ namespace CEnhancedList
     protected:
         void resizeEvent(QResizeEvent* e) override;
         bool event(QEvent* event) override;
+        bool eventFilter(QObject* obj, QEvent* event) override;
+        void showEvent(QShowEvent* event) override;
+        void hideEvent(QHideEvent* event) override;
+
+        virtual CEnhancedList::Item* createItem(const CEnhancedList::ItemOptions& options) { return new Item(this->m_list, options); }
+        CEnhancedList::Item* newItem(const QString& text = QString());
+        void placeNewItem(int row, CEnhancedList::Item* item);
 
     protected slots:
         void onEditChanged();
         void onItemEdited();
+        void onItemReplaced(const QString& previous);
         void onCurrentItemChanged(QListWidgetItem* current, QListWidgetItem* previous);
         void onItemActivated(QListWidgetItem* item);
         void onItemChanged(QListWidgetItem* item);
@@ -228,13 +543,70 @@ namespace CEnhancedList
         void onItemDoubleClicked(QListWidgetItem* item);
         void onItemEntered(QListWidgetItem* item);
         void onItemPressed(QListWidgetItem* item);
+        void onItemKeyReleased(const QString& key);
+        void onSectionHeaderReleased(int section);
+        void onItemCacheChanged(qint64 rowWidget, qint64 highlighted);
+        void onRowsChanged();
+        void onRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
 
     private:
+        friend class CacheManager;
+
+        bool moveRow(int from, int to) { return this->moveRowRange(from, 1, to); }
+        bool moveRowRange(int from, int count, int to);
+        int sectionEnd(int section) const;
+        int sectionAt(int row) const;
+        void adoptSection(int first, int count);
+        qint64 sectionRank(int section, bool header) const;
+        void invalidateRows(int first);
+        bool beginBulkInsert(int count, qint64 length);
+        void endBulkInsert(bool replaying);
+        void scheduleLabels();
+        int firstVisibleRow() const;
+        int visibleRowBudget() const;
+
+        struct ExportRow
+        {
+            QString text;
+            bool header;
+        };
+        bool exportRow(int row, const CEnhancedList::ExportOptions& options, ExportRow& out) const;
+        QVector<ExportRow> exportSnapshot(const CEnhancedList::ExportOptions& options) const;
+        static bool writeExport(QIODevice* device, int count, const std::function<bool(int, ExportRow&)>& rowAt, const CEnhancedList::ExportOptions& options);
+        void applyRowVisibility(int row);
+        int measureRow(int row, int width);
+        int indexedHeight(int row) const;
+        void ensureHeightIndex();
+        bool hasPixelLayout() const;
+        void replay(const EditHistory::Entry& entry, bool undo);
+
         QListWidget* m_list;
+        HeightIndex m_heights;
+        bool m_heightsDirty;
+        EditHistory m_history;
+        bool m_replaying;
+        mutable int m_rowsDirtyFrom;
+        QHash<QString, CEnhancedList::Item*> m_keys;
+
+        struct Section
+        {
+            QString title;
+            CEnhancedList::Item* header;
+            bool collapsed;
+        };
+        QVector<Section> m_sections;
+
+        qint64 m_memoryBudget;
+        bool m_cachesReleased;
+        bool m_labelsPending;
+        qint64 m_widgetBytes;
+        qint64 m_highlightedBytes;
+        Qt::SortOrder m_sortOrder;
         bool m_editable;
         int m_margin;
         Qt::TextFormat m_format;
         std::function<QString(Item*)> m_transformFn;
+        std::function<QSyntaxHighlighter*(QTextDocument*)> m_highlighterFn;
 
         QString m_colorEditBackground;
         QString m_colorEditForeground;
@@ -256,10 +628,132 @@ namespace CEnhancedList
         void itemSelectionChanged();
         void itemEdited(CEnhancedList::Item* item);
     };
+
+
+    template<typename T>
+    class TypedWidget;
+
+    // Item carrying a user payload inline, next to the row
+    template<typename T>
+    class TypedItem: public Item
+    {
+    public:
+        TypedItem(QListWidget* parent = nullptr): Item(parent), m_payload() {}
+        TypedItem(QListWidget* parent, const ItemOptions& options): Item(parent, options), m_payload() {}
+
+        const T& payload() const { return this->m_payload; }
+        T& payload() { return this->m_payload; }
+        void setPayload(const T& payload) { this->m_payload = payload; }
+        void setPayload(T&& payload) { this->m_payload = std::move(payload); }
+
+        bool operator <(const QListWidgetItem& other) const override
+        {
+            // The comparator is looked up through the owning list, so a taken item never keeps a stale one
+            QListWidget* list = this->listWidget();
+            auto owner = list == nullptr ? nullptr : dynamic_cast<const TypedWidget<T>*>(list->parentWidget());
+            const TypedItem<T>& typed = static_cast<const TypedItem<T>&>(other);
+            if (owner == nullptr || !owner->lessFn() || this->sortRank() != typed.sortRank()) return Item::operator <(other);
+            return owner->lessFn()(this->m_payload, typed.m_payload);
+        }
+
+    private:
+        T m_payload;
+    };
+
+
+    template<typename T>
+    class TypedWidget: public Widget
+    {
+    public:
+        using ItemType = TypedItem<T>;
+
+        // History is off by default: replayed rows would come back without their payload
+        explicit TypedWidget(QWidget* parent = nullptr): Widget(parent) { this->setHistoryDepth(0); }
+
+        using Widget::addItem;
+        using Widget::insertItem;
+        using Widget::findItems;
+
+        ItemType* addItem(const QString& label, T payload)
+        {
+            ItemType* item = static_cast<ItemType*>(this->newItem(label));
+            item->setPayload(std::move(payload));
+            Widget::addItem(item);
+            return item;
+        }
+
+        ItemType* insertItem(int row, const QString& label, T payload)
+        {
+            ItemType* item = static_cast<ItemType*>(this->newItem(label));
+            item->setPayload(std::move(payload));
+            this->placeNewItem(row, item);
+            return item;
+        }
+
+        ItemType* item(int row) const { return static_cast<ItemType*>(Widget::item(row)); }
+        ItemType* currentItem() const { return static_cast<ItemType*>(Widget::currentItem()); }
+        const T& payload(int row) const { return this->item(row)->payload(); }
+
+        void setTransformFn(std::function<QString(const QString&, const T&)> fn)
+        {
+            if (!fn) {
+                Widget::setTransformFn(nullptr);
+                return;
+            }
+            Widget::setTransformFn([fn](Item* item){
+                auto typed = static_cast<ItemType*>(item);
+                return fn(typed->text(), typed->payload());
+            });
+        }
+
+        const std::function<bool(const T&, const T&)>& lessFn() const { return this->m_lessFn; }
+        void setLessFn(std::function<bool(const T&, const T&)> fn) { this->m_lessFn = std::move(fn); }
+
+        template<typename Fn>
+        void forEachItem(Fn fn) const
+        {
+            for (int row = 0; row < this->count(); row++) {
+                if (this->item(row)->isHeader()) continue;
+                fn(this->item(row), this->item(row)->payload());
+            }
+        }
+
+        int findRow(const std::function<bool(const T&)>& fn, int from = 0) const
+        {
+            for (int row = qMax(0, from); row < this->count(); row++) {
+                if (!this->item(row)->isHeader() && fn(this->item(row)->payload())) return row;
+            }
+            return -1;
+        }
+
+        ItemType* findItem(const std::function<bool(const T&)>& fn) const
+        {
+            int row = this->findRow(fn);
+            return row < 0 ? nullptr : this->item(row);
+        }
+
+        QList<ItemType*> findItems(const std::function<bool(const T&)>& fn) const
+        {
+            QList<ItemType*> items;
+            for (int row = 0; row < this->count(); row++) {
+                ItemType* item = this->item(row);
+                if (!item->isHeader() && fn(item->payload())) items.append(item);
+            }
+            return items;
+        }
+
+    protected:
+        CEnhancedList::Item* createItem(const CEnhancedList::ItemOptions& options) override { return new ItemType(this->listWidget(), options); }
+
+    private:
+        std::function<bool(const T&, const T&)> m_lessFn;
+    };
 }
 
 using CEnhancedListWidget = CEnhancedList::Widget;
 using CEnhancedListWidgetItem = CEnhancedList::Item;
+template<typename T> using CEnhancedTypedListWidget = CEnhancedList::TypedWidget<T>;
+template<typename T> using CEnhancedTypedListWidgetItem = CEnhancedList::TypedItem<T>;
 
 
 #endif // CENHANCEDLISTWIDGET_H
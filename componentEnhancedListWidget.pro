@@ -1,4 +1,4 @@
-QT += widgets
+QT += widgets concurrent
 
 TEMPLATE = lib
 CONFIG += staticlib
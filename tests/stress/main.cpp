@@ -0,0 +1,329 @@
+#include "CEnhancedListWidget.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QMap>
+#include <QPlainTextEdit>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// Randomized operation sequences against CEnhancedList::Widget on the offscreen platform.
+// Invariants are checked as it runs; latency percentiles, peak RSS and leaked editor
+// objects are reported at the end.
+//
+//   stress [--rows N] [--initial N] [--steps N] [--check-every N] [--seed N]
+//
+// Exit code: 0 on success, 1 on a consistency failure, 2 on leaked editors or filters.
+
+using CEnhancedList::Item;
+using CEnhancedList::Widget;
+
+
+static qint64 peakRssKb()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+static QString randomText(QRandomGenerator& random)
+{
+    static const char* words[] = {
+        "alpha", "beta", "gamma", "delta", "epsilon", "list", "row", "widget",
+        "label", "editor", "Qt", "undo", "redo", "sort", "filter", "section"
+    };
+    const int wordCount = int(sizeof(words) / sizeof(words[0]));
+    int count = random.bounded(1, 12);
+    QString text;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) text += random.bounded(8) == 0 ? '\n' : ' ';
+        text += words[random.bounded(wordCount)];
+    }
+    return text;
+}
+
+static QStringList randomTexts(QRandomGenerator& random, int count)
+{
+    QStringList texts;
+    texts.reserve(count);
+    for (int i = 0; i < count; i++) {
+        texts.append(randomText(random));
+    }
+    return texts;
+}
+
+static int liveEditors()
+{
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    int count = 0;
+    for (QWidget* widget: QApplication::allWidgets()) {
+        if (qobject_cast<QPlainTextEdit*>(widget) != nullptr || qobject_cast<QLineEdit*>(widget) != nullptr) count++;
+    }
+    return count;
+}
+
+static void sendKey(QWidget* editor, int key, Qt::KeyboardModifiers modifiers)
+{
+    QKeyEvent release(QEvent::KeyRelease, key, modifiers);
+    QCoreApplication::sendEvent(editor, &release);
+}
+
+
+class Latencies
+{
+public:
+    void add(const QString& op, qint64 nsecs) { this->m_samples[op].append(nsecs); }
+
+    void report() const
+    {
+        std::printf("%-10s %10s %12s %12s %12s\n", "op", "count", "p50 us", "p99 us", "max us");
+        for (auto it = this->m_samples.constBegin(); it != this->m_samples.constEnd(); ++it) {
+            QVector<qint64> samples = it.value();
+            std::sort(samples.begin(), samples.end());
+            int n = samples.count();
+            std::printf("%-10s %10d %12.1f %12.1f %12.1f\n", qPrintable(it.key()), n,
+                        samples.at((n - 1) * 50 / 100) / 1000.0,
+                        samples.at((n - 1) * 99 / 100) / 1000.0,
+                        samples.last() / 1000.0);
+        }
+    }
+
+private:
+    QMap<QString, QVector<qint64>> m_samples;
+};
+
+
+class Stress
+{
+public:
+    Stress(int maxRows, quint32 seed)
+    {
+        this->m_random.seed(seed);
+        this->m_maxRows = maxRows;
+        this->m_batch = qMax(1, maxRows / 1000);
+        this->m_leakedEditors = 0;
+        this->m_leakedFilters = 0;
+        this->m_widget.setEditable(true);
+        this->m_widget.resize(600, 800);
+        this->m_widget.show();
+    }
+
+    void load(int rows)
+    {
+        QStringList labels = randomTexts(this->m_random, rows);
+        this->time("load", [this, &labels]() { this->m_widget.addItems(labels); });
+        this->settle();
+    }
+
+    void step()
+    {
+        static const char* ops[] = {
+            "add", "insert", "take", "setText", "sort", "edit", "select", "resize", "scroll", "undo", "redo"
+        };
+        static const int weights[] = { 8, 8, 10, 20, 2, 10, 15, 3, 15, 5, 4 };
+        int total = 0;
+        for (int weight: weights) total += weight;
+        int pick = this->m_random.bounded(total);
+        int op = 0;
+        while (pick >= weights[op]) pick -= weights[op++];
+        this->run(ops[op]);
+        this->settle();
+    }
+
+    bool check(QString* error)
+    {
+        if (!this->m_widget.checkConsistency(error)) return false;
+
+        int expected = this->m_editing != nullptr && this->m_editing->isEditing() ? 1 : 0;
+        this->m_leakedEditors = qMax(this->m_leakedEditors, liveEditors() - expected);
+        this->m_leakedFilters = qMax(this->m_leakedFilters, CEnhancedList::ItemEventFilter::instances() - expected);
+        return true;
+    }
+
+    void finish()
+    {
+        this->finishEdit(false);
+        this->time("clear", [this]() { this->m_widget.clear(); });
+        this->settle();
+        this->m_leakedEditors = qMax(this->m_leakedEditors, liveEditors());
+        this->m_leakedFilters = qMax(this->m_leakedFilters, CEnhancedList::ItemEventFilter::instances());
+    }
+
+    int count() const { return this->m_widget.count(); }
+    int leakedEditors() const { return this->m_leakedEditors; }
+    int leakedFilters() const { return this->m_leakedFilters; }
+    const Latencies& latencies() const { return this->m_latencies; }
+    const QString& lastOp() const { return this->m_lastOp; }
+
+private:
+    template<typename Fn>
+    void time(const QString& op, Fn fn)
+    {
+        this->m_lastOp = op;
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        this->m_latencies.add(op, timer.nsecsElapsed());
+    }
+
+    // Deferred work (label passes, view layout) is timed separately from the operation
+    void settle()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        this->m_latencies.add("events", timer.nsecsElapsed());
+    }
+
+    int randomRow() { return this->m_random.bounded(this->m_widget.count()); }
+    int batchSize() { return qMin(this->m_random.bounded(1, this->m_batch + 1), this->m_maxRows - this->m_widget.count()); }
+
+    void run(const QString& op)
+    {
+        const int count = this->m_widget.count();
+        if (op == "add" && count < this->m_maxRows) {
+            QStringList labels = randomTexts(this->m_random, this->batchSize());
+            this->time(op, [this, &labels]() { this->m_widget.addItems(labels); });
+        } else if (op == "insert" && count < this->m_maxRows) {
+            QStringList labels = randomTexts(this->m_random, this->batchSize());
+            int row = this->m_random.bounded(count + 1);
+            this->time(op, [this, row, &labels]() { this->m_widget.insertItems(row, labels); });
+        } else if (op == "take" && count > 0) {
+            int row = this->randomRow();
+            this->time(op, [this, row]() { delete this->m_widget.takeItem(row); });
+        } else if (op == "setText" && count > 0) {
+            Item* item = this->m_widget.item(this->randomRow());
+            QString text = randomText(this->m_random);
+            this->time(op, [this, item, &text]() {
+                item->setText(text);
+                this->m_widget.updateItemHeight(item);
+            });
+        } else if (op == "sort" && count > 0) {
+            Qt::SortOrder order = this->m_random.bounded(2) == 0 ? Qt::AscendingOrder : Qt::DescendingOrder;
+            this->time(op, [this, order]() { this->m_widget.sortItems(order); });
+        } else if (op == "edit" && count > 0) {
+            if (this->m_editing != nullptr && this->m_editing->isEditing()) this->finishEdit(this->m_random.bounded(3) != 0);
+            else this->startEdit();
+        } else if (op == "select" && count > 0) {
+            int row = this->randomRow();
+            this->time(op, [this, row]() { this->m_widget.setCurrentRow(row, QItemSelectionModel::ClearAndSelect); });
+        } else if (op == "resize") {
+            int width = this->m_random.bounded(200, 1200);
+            int height = this->m_random.bounded(200, 900);
+            this->time(op, [this, width, height]() { this->m_widget.resize(width, height); });
+        } else if (op == "scroll" && count > 0) {
+            QScrollBar* bar = this->m_widget.listWidget()->verticalScrollBar();
+            int value = this->m_random.bounded(bar->maximum() + 1);
+            this->time(op, [bar, value]() { bar->setValue(value); });
+        } else if (op == "undo") {
+            this->time(op, [this]() { this->m_widget.undo(); });
+        } else if (op == "redo") {
+            this->time(op, [this]() { this->m_widget.redo(); });
+        }
+    }
+
+    void startEdit()
+    {
+        Item* item = this->m_widget.item(this->randomRow());
+        if (item->isHeader()) return;
+        QString text = randomText(this->m_random);
+        this->time("editStart", [this, item, &text]() {
+            item->startEdit();
+            QWidget* editor = this->m_widget.listWidget()->itemWidget(item);
+            QPlainTextEdit* textEdit = qobject_cast<QPlainTextEdit*>(editor);
+            QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor);
+            if (textEdit != nullptr) textEdit->setPlainText(text);
+            else if (lineEdit != nullptr) lineEdit->setText(text);
+        });
+        this->m_editing = item;
+    }
+
+    void finishEdit(bool save)
+    {
+        if (this->m_editing == nullptr || !this->m_editing->isEditing()) return;
+        QWidget* editor = this->m_widget.listWidget()->itemWidget(this->m_editing);
+        Item* item = this->m_editing;
+        this->m_editing = nullptr;
+        if (editor == nullptr || item->listWidget() == nullptr) return;
+        bool multiline = qobject_cast<QPlainTextEdit*>(editor) != nullptr;
+        this->time(save ? "editSave" : "editCancel", [editor, save, multiline]() {
+            if (!save) sendKey(editor, Qt::Key_Escape, Qt::NoModifier);
+            else sendKey(editor, Qt::Key_Return, multiline ? Qt::ControlModifier : Qt::NoModifier);
+        });
+    }
+
+    Widget m_widget;
+    QRandomGenerator m_random;
+    QPointer<Item> m_editing;
+    Latencies m_latencies;
+    QString m_lastOp;
+    int m_maxRows;
+    int m_batch;
+    int m_leakedEditors;
+    int m_leakedFilters;
+};
+
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption rowsOption("rows", "Maximum number of rows.", "n", "10000");
+    QCommandLineOption initialOption("initial", "Rows loaded before the first step (default: half of --rows).", "n");
+    QCommandLineOption stepsOption("steps", "Number of random operations.", "n", "2000");
+    QCommandLineOption checkOption("check-every", "Steps between consistency checks.", "n", "1");
+    QCommandLineOption seedOption("seed", "Random seed.", "n", "1");
+    parser.addOptions({ rowsOption, initialOption, stepsOption, checkOption, seedOption });
+    parser.process(app);
+
+    const int rows = qMax(1, parser.value(rowsOption).toInt());
+    const int initial = parser.isSet(initialOption) ? qBound(0, parser.value(initialOption).toInt(), rows) : rows / 2;
+    const int steps = parser.value(stepsOption).toInt();
+    const int checkEvery = qMax(1, parser.value(checkOption).toInt());
+    const quint32 seed = parser.value(seedOption).toUInt();
+
+    std::printf("rows %d, initial %d, steps %d, check every %d, seed %u\n", rows, initial, steps, checkEvery, seed);
+
+    Stress stress(rows, seed);
+    stress.load(initial);
+
+    QString error;
+    for (int step = 1; step <= steps; step++) {
+        stress.step();
+        if (step % checkEvery != 0 && step != steps) continue;
+        if (!stress.check(&error)) {
+            std::fprintf(stderr, "step %d (%s, %d rows): %s\n", step, qPrintable(stress.lastOp()), stress.count(), qPrintable(error));
+            return 1;
+        }
+    }
+    std::printf("final rows %d\n", stress.count());
+    stress.finish();
+
+    stress.latencies().report();
+    std::printf("peak RSS %lld KiB\n", static_cast<long long>(peakRssKb()));
+    std::printf("leaked editors %d, leaked event filters %d\n", stress.leakedEditors(), stress.leakedFilters());
+    return stress.leakedEditors() > 0 || stress.leakedFilters() > 0 ? 2 : 0;
+}
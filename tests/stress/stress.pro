@@ -0,0 +1,16 @@
+QT += widgets concurrent
+
+TEMPLATE = app
+TARGET = stress
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+# Headless stress run of the widget sources; see main.cpp for the options
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../CEnhancedListWidget.cpp
+
+HEADERS += \
+    ../../CEnhancedListWidget.h